@@ -0,0 +1,95 @@
+#include "FFTCorrelator.h"
+#include "TemplateMatching.h"
+#include <numeric>
+
+static size_t findRoot(std::vector<size_t>& parent, size_t i) {
+    while (parent[i] != i) i = parent[i] = parent[parent[i]];
+    return i;
+}
+
+void FFTCorrelator::prepare(const std::vector<cv::Mat>& templates, const std::vector<cv::Rect>& search_rois) {
+    m_groups.clear();
+    m_num_templates = templates.size();
+
+    std::vector<size_t> parent(templates.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    for (size_t a = 0; a < search_rois.size(); ++a) {
+        for (size_t b = a + 1; b < search_rois.size(); ++b) {
+            if ((search_rois[a] & search_rois[b]).area() > 0) parent[findRoot(parent, b)] = findRoot(parent, a);
+        }
+    }
+
+    std::vector<int> group_of_root(templates.size(), -1);
+    for (size_t t = 0; t < templates.size(); ++t) {
+        size_t root = findRoot(parent, t);
+        if (group_of_root[root] < 0) {
+            group_of_root[root] = (int)m_groups.size();
+            m_groups.push_back(Group{ search_rois[t], cv::Size(), {} });
+        }
+        Group& group = m_groups[group_of_root[root]];
+        group.union_roi |= search_rois[t];
+        group.entries.push_back(Entry{ t, templates[t].size(), search_rois[t], cv::Mat(), 0.0 });
+    }
+
+    for (auto& group : m_groups) {
+        // Circular correlation does not wrap into valid positions as long as the transform is
+        // at least as large as the window itself.
+        group.dft_size = cv::Size(cv::getOptimalDFTSize(group.union_roi.width), cv::getOptimalDFTSize(group.union_roi.height));
+        for (auto& entry : group.entries) {
+            cv::Mat templ;
+            templates[entry.template_index].convertTo(templ, CV_32F);
+            templ -= cv::mean(templ);
+            entry.template_norm = cv::norm(templ);
+
+            cv::Mat padded = cv::Mat::zeros(group.dft_size, CV_32F);
+            templ.copyTo(padded(cv::Rect(0, 0, templ.cols, templ.rows)));
+            cv::dft(padded, entry.spectrum, 0, templ.rows);
+        }
+    }
+}
+
+void FFTCorrelator::match(const cv::Mat& frame_gray, std::vector<cv::Point2f>& peaks, bool subpixel) const {
+    peaks.assign(m_num_templates, cv::Point2f(0, 0));
+
+    cv::Mat window, padded, window_spectrum, product, cross, sum, sqsum, correlation_map;
+    for (const auto& group : m_groups) {
+        frame_gray(group.union_roi).convertTo(window, CV_32F);
+        cv::copyMakeBorder(window, padded, 0, group.dft_size.height - window.rows, 0, group.dft_size.width - window.cols, cv::BORDER_CONSTANT, cv::Scalar(0));
+        cv::dft(padded, window_spectrum, 0, window.rows);
+        cv::integral(window, sum, sqsum, CV_64F, CV_64F);
+
+        for (const auto& entry : group.entries) {
+            cv::mulSpectrums(window_spectrum, entry.spectrum, product, 0, true);
+            cv::dft(product, cross, cv::DFT_INVERSE | cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+
+            const int tw = entry.template_size.width;
+            const int th = entry.template_size.height;
+            const double area = (double)tw * th;
+            const cv::Point offset = entry.search_roi.tl() - group.union_roi.tl();
+            correlation_map.create(entry.search_roi.height - th + 1, entry.search_roi.width - tw + 1, CV_32F);
+
+            for (int y = 0; y < correlation_map.rows; ++y) {
+                const int wy = offset.y + y;
+                const float* cross_row = cross.ptr<float>(wy);
+                const double* s0 = sum.ptr<double>(wy);
+                const double* s1 = sum.ptr<double>(wy + th);
+                const double* q0 = sqsum.ptr<double>(wy);
+                const double* q1 = sqsum.ptr<double>(wy + th);
+                float* out = correlation_map.ptr<float>(y);
+                for (int x = 0; x < correlation_map.cols; ++x) {
+                    const int wx = offset.x + x;
+                    double window_sum = s1[wx + tw] - s1[wx] - s0[wx + tw] + s0[wx];
+                    double window_sqsum = q1[wx + tw] - q1[wx] - q0[wx + tw] + q0[wx];
+                    double variance = std::max(0.0, window_sqsum - window_sum * window_sum / area);
+                    double denom = std::sqrt(variance) * entry.template_norm;
+                    out[x] = denom > 1e-6 ? (float)(cross_row[wx] / denom) : 0.0f;
+                }
+            }
+
+            cv::Point peak_loc;
+            cv::minMaxLoc(correlation_map, nullptr, nullptr, nullptr, &peak_loc);
+            cv::Point2f peak = subpixel ? refinePeakSubpixel(correlation_map, peak_loc) : cv::Point2f(peak_loc.x, peak_loc.y);
+            peaks[entry.template_index] = peak + cv::Point2f(entry.search_roi.x, entry.search_roi.y);
+        }
+    }
+}
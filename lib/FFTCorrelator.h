@@ -0,0 +1,33 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Frequency-domain TM_CCOEFF_NORMED for a fixed set of templates whose search windows do not
+// move between frames. Template spectra are computed once in prepare(); templates whose windows
+// overlap are grouped so each frame needs a single forward FFT per group.
+class FFTCorrelator {
+public:
+    void prepare(const std::vector<cv::Mat>& templates, const std::vector<cv::Rect>& search_rois);
+    bool empty() const { return m_groups.empty(); }
+
+    // Writes, per template, the best match's top-left corner in frame coordinates.
+    void match(const cv::Mat& frame_gray, std::vector<cv::Point2f>& peaks, bool subpixel) const;
+
+private:
+    struct Entry {
+        size_t template_index;
+        cv::Size template_size;
+        cv::Rect search_roi;    // frame coordinates
+        cv::Mat spectrum;       // DFT of the zero-mean template padded to the group's dft_size
+        double template_norm;   // sqrt(sum((T - mean(T))^2))
+    };
+    struct Group {
+        cv::Rect union_roi;
+        cv::Size dft_size;
+        std::vector<Entry> entries;
+    };
+
+    std::vector<Group> m_groups;
+    size_t m_num_templates = 0;
+};
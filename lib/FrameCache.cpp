@@ -0,0 +1,250 @@
+#include "FrameCache.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char kMagic[8] = { 'S', 'A', 'F', 'R', 'A', 'M', 'E', 'S' };
+const uint32_t kVersion = 1;
+const uint64_t kPageSize = 4096;
+
+struct FrameCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t frame_count;
+    int32_t color_rows, color_cols, color_type;
+    int32_t gray_rows, gray_cols, gray_type;
+    uint64_t key_length;
+    uint64_t data_offset;
+};
+
+uint64_t frameBytes(int rows, int cols, int type) {
+    return (uint64_t)rows * cols * CV_ELEM_SIZE(type);
+}
+
+void writeRows(std::ofstream& out, const cv::Mat& frame) {
+    size_t row_bytes = frame.cols * frame.elemSize();
+    for (int y = 0; y < frame.rows; ++y) out.write((const char*)frame.ptr(y), row_bytes);
+}
+
+} // namespace
+
+std::string frameCacheFileIdentity(const std::string& video_path) {
+    std::error_code ec;
+    fs::path canonical = fs::canonical(video_path, ec);
+    if (ec) return std::string();
+    uintmax_t size = fs::file_size(canonical, ec);
+    if (ec) return std::string();
+    auto mtime = fs::last_write_time(canonical, ec);
+    if (ec) return std::string();
+    return canonical.string() + "|" + std::to_string(size) + "|" + std::to_string((long long)mtime.time_since_epoch().count());
+}
+
+std::string frameCachePath(const std::string& cache_dir, const std::string& key) {
+    // FNV-1a; collisions are caught by the key comparison in open().
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : key) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.safc", (unsigned long long)hash);
+    return (fs::path(cache_dir) / name).string();
+}
+
+FrameCacheWriter::~FrameCacheWriter() {
+    discard();
+}
+
+bool FrameCacheWriter::open(const std::string& cache_path, const std::string& key, int frame_count, const cv::Mat& color_like,
+                            const cv::Mat& gray_like) {
+    discard();
+    if (frame_count <= 0 || color_like.empty()) return false;
+
+    FrameCacheHeader header = {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.frame_count = (uint32_t)frame_count;
+    header.color_rows = color_like.rows;
+    header.color_cols = color_like.cols;
+    header.color_type = color_like.type();
+    header.gray_rows = gray_like.rows;
+    header.gray_cols = gray_like.cols;
+    header.gray_type = gray_like.type();
+    header.key_length = key.size();
+    header.data_offset = (sizeof(header) + key.size() + kPageSize - 1) / kPageSize * kPageSize;
+
+    std::error_code ec;
+    fs::create_directories(fs::path(cache_path).parent_path(), ec);
+    m_cache_path = cache_path;
+    m_temp_path = cache_path + ".tmp";
+    m_out.open(m_temp_path, std::ios::binary | std::ios::trunc);
+    if (!m_out) {
+        discard();
+        return false;
+    }
+    m_out.write((const char*)&header, sizeof(header));
+    m_out.write(key.data(), key.size());
+    m_color_size = color_like.size();
+    m_color_type = color_like.type();
+    m_gray_size = gray_like.size();
+    m_gray_type = gray_like.type();
+    m_color_bytes = frameBytes(color_like.rows, color_like.cols, color_like.type());
+    m_gray_bytes = frameBytes(gray_like.rows, gray_like.cols, gray_like.type());
+    m_data_offset = header.data_offset;
+    m_frame_count = frame_count;
+    m_written = 0;
+    return true;
+}
+
+bool FrameCacheWriter::write(const cv::Mat& color, const cv::Mat& gray) {
+    if (!m_out.is_open() || m_written >= m_frame_count) return false;
+    if (color.size() != m_color_size || color.type() != m_color_type) return false;
+    if (m_gray_bytes > 0 && (gray.size() != m_gray_size || gray.type() != m_gray_type)) return false;
+
+    // Color frames come first, so a frame's gray half lands after all of them.
+    m_out.seekp((std::streamoff)(m_data_offset + m_written * m_color_bytes));
+    writeRows(m_out, color);
+    if (m_gray_bytes > 0) {
+        m_out.seekp((std::streamoff)(m_data_offset + m_frame_count * m_color_bytes + m_written * m_gray_bytes));
+        writeRows(m_out, gray);
+    }
+    m_written++;
+    return (bool)m_out;
+}
+
+bool FrameCacheWriter::finish() {
+    if (!m_out.is_open()) return false;
+    bool ok = m_written == m_frame_count && (bool)m_out;
+    m_out.close();
+    std::error_code ec;
+    if (ok) fs::rename(m_temp_path, m_cache_path, ec);
+    if (!ok || ec) {
+        fs::remove(m_temp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+void FrameCacheWriter::discard() {
+    if (m_out.is_open()) {
+        m_out.close();
+        std::error_code ec;
+        fs::remove(m_temp_path, ec);
+    }
+    m_written = 0;
+    m_frame_count = 0;
+}
+
+bool writeFrameCache(const std::string& cache_path, const std::string& key,
+                     const std::vector<cv::Mat>& frames_color, const std::vector<cv::Mat>& frames_gray) {
+    if (frames_color.empty() || frames_color.size() != frames_gray.size()) return false;
+    FrameCacheWriter writer;
+    if (!writer.open(cache_path, key, (int)frames_color.size(), frames_color[0], frames_gray[0])) return false;
+    for (size_t i = 0; i < frames_color.size(); ++i) {
+        if (!writer.write(frames_color[i], frames_gray[i])) return false;
+    }
+    return writer.finish();
+}
+
+MappedFrameCache::~MappedFrameCache() {
+    close();
+}
+
+bool MappedFrameCache::open(const std::string& cache_path, const std::string& key) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(cache_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < (LONGLONG)sizeof(FrameCacheHeader)) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (!data) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    m_file = file;
+    m_mapping = mapping;
+    m_data = data;
+    m_size = (size_t)file_size.QuadPart;
+#else
+    int fd = ::open(cache_path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(FrameCacheHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) return false;
+    m_data = data;
+    m_size = (size_t)st.st_size;
+#endif
+
+    FrameCacheHeader header;
+    std::memcpy(&header, m_data, sizeof(header));
+    const char* bytes = (const char*)m_data;
+    uint64_t color_bytes = frameBytes(header.color_rows, header.color_cols, header.color_type);
+    uint64_t gray_bytes = frameBytes(header.gray_rows, header.gray_cols, header.gray_type);
+    bool valid = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 && header.version == kVersion &&
+                 header.frame_count > 0 && header.key_length == key.size() &&
+                 sizeof(header) + header.key_length <= header.data_offset &&
+                 header.data_offset + header.frame_count * (color_bytes + gray_bytes) <= m_size &&
+                 std::memcmp(bytes + sizeof(header), key.data(), key.size()) == 0;
+    if (!valid) {
+        close();
+        return false;
+    }
+
+    char* color_data = (char*)m_data + header.data_offset;
+    char* gray_data = color_data + header.frame_count * color_bytes;
+    for (uint32_t i = 0; i < header.frame_count; ++i) {
+        m_frames_color.emplace_back(header.color_rows, header.color_cols, header.color_type, color_data + i * color_bytes);
+        m_frames_gray.emplace_back(header.gray_rows, header.gray_cols, header.gray_type, gray_data + i * gray_bytes);
+    }
+    return true;
+}
+
+void MappedFrameCache::close() {
+    m_frames_color.clear();
+    m_frames_gray.clear();
+    if (!m_data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping);
+    CloseHandle(m_file);
+    m_mapping = nullptr;
+    m_file = nullptr;
+#else
+    munmap(m_data, m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// On-disk cache of preprocessed frame stacks. A cache file is a fixed header, the key text,
+// then every color frame followed by every gray frame, packed row-contiguous from a page
+// aligned offset. Opening maps the file and hands out cv::Mat headers pointing into the
+// mapping, so nothing is decoded or copied.
+//
+// The key is built by the caller from the video's identity and every parameter that changes
+// the preprocessed pixels; it is stored in full and compared on open, the file name is only
+// its hash.
+
+// Canonical path, size and modification time, or an empty string if the file cannot be read.
+std::string frameCacheFileIdentity(const std::string& video_path);
+
+std::string frameCachePath(const std::string& cache_dir, const std::string& key);
+
+// Writes a cache one frame at a time, for stacks too large to hold in memory. Like
+// writeFrameCache it writes to a temporary file that finish() renames into place; a writer
+// destroyed before finish() removes it.
+class FrameCacheWriter {
+public:
+    FrameCacheWriter() = default;
+    ~FrameCacheWriter();
+    FrameCacheWriter(const FrameCacheWriter&) = delete;
+    FrameCacheWriter& operator=(const FrameCacheWriter&) = delete;
+
+    // Every frame written must have the size and type of color_like and gray_like. gray_like
+    // may be empty for a color-only cache, whose framesGray() are then empty headers.
+    bool open(const std::string& cache_path, const std::string& key, int frame_count, const cv::Mat& color_like,
+              const cv::Mat& gray_like);
+    // Writes the next frame; gray is ignored for a color-only cache.
+    bool write(const cv::Mat& color, const cv::Mat& gray = cv::Mat());
+    // False, and nothing is renamed, unless all frame_count frames were written.
+    bool finish();
+
+private:
+    void discard();
+
+    std::ofstream m_out;
+    std::string m_cache_path;
+    std::string m_temp_path;
+    cv::Size m_color_size;
+    int m_color_type = 0;
+    cv::Size m_gray_size;
+    int m_gray_type = 0;
+    uint64_t m_color_bytes = 0;
+    uint64_t m_gray_bytes = 0;
+    uint64_t m_data_offset = 0;
+    int m_frame_count = 0;
+    int m_written = 0;
+};
+
+// Writes to a temporary file and renames it, so a partly written cache is never opened.
+bool writeFrameCache(const std::string& cache_path, const std::string& key,
+                     const std::vector<cv::Mat>& frames_color, const std::vector<cv::Mat>& frames_gray);
+
+class MappedFrameCache {
+public:
+    MappedFrameCache() = default;
+    ~MappedFrameCache();
+    MappedFrameCache(const MappedFrameCache&) = delete;
+    MappedFrameCache& operator=(const MappedFrameCache&) = delete;
+
+    // False if the file is missing, truncated, from another format version or for another key.
+    bool open(const std::string& cache_path, const std::string& key);
+    void close();
+
+    // Valid while this object is open. The mapping is private, so writes never reach the file.
+    const std::vector<cv::Mat>& framesColor() const { return m_frames_color; }
+    const std::vector<cv::Mat>& framesGray() const { return m_frames_gray; }
+
+private:
+    void* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+    std::vector<cv::Mat> m_frames_color;
+    std::vector<cv::Mat> m_frames_gray;
+};
@@ -0,0 +1,42 @@
+#include "FrameSelection.h"
+
+#include <algorithm>
+#include <limits>
+
+void selectViewpoints(const std::vector<cv::Point2f>& shifts, int count, std::vector<int>& selected, std::vector<int>& weights) {
+    const int num_frames = (int)shifts.size();
+    selected.clear();
+    weights.clear();
+    if (num_frames == 0) return;
+    count = std::max(1, std::min(count, num_frames));
+
+    // Squared distance from every frame to its nearest pick, and which pick that is.
+    std::vector<float> distance(num_frames, std::numeric_limits<float>::max());
+    std::vector<int> nearest(num_frames, 0);
+    auto add_pick = [&](int pick) {
+        selected.push_back(pick);
+        for (int i = 0; i < num_frames; ++i) {
+            cv::Point2f d = shifts[i] - shifts[pick];
+            float d2 = d.dot(d);
+            if (d2 < distance[i]) {
+                distance[i] = d2;
+                nearest[i] = pick;
+            }
+        }
+    };
+
+    add_pick(0);
+    while ((int)selected.size() < count) {
+        int farthest = (int)(std::max_element(distance.begin(), distance.end()) - distance.begin());
+        // Every remaining frame duplicates a pick; more picks add nothing.
+        if (distance[farthest] <= 0.0f) break;
+        add_pick(farthest);
+    }
+
+    std::sort(selected.begin(), selected.end());
+    weights.assign(selected.size(), 0);
+    for (int i = 0; i < num_frames; ++i) {
+        size_t slot = std::lower_bound(selected.begin(), selected.end(), nearest[i]) - selected.begin();
+        weights[slot]++;
+    }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Picks up to count frames whose shifts cover the aperture evenly. Farthest-point sampling
+// starts at frame 0 and repeatedly adds the frame farthest from every frame picked so far;
+// each frame is then binned to its nearest pick, and a pick's weight is the size of its bin.
+// Accumulating the picks with those weights approximates the full stack's aperture, where
+// clusters of near-identical viewpoints count as often as they occurred.
+//
+// selected is sorted and always starts with frame 0; weights sum to shifts.size().
+void selectViewpoints(const std::vector<cv::Point2f>& shifts, int count, std::vector<int>& selected, std::vector<int>& weights);
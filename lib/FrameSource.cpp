@@ -0,0 +1,51 @@
+#include "FrameSource.h"
+
+#include <algorithm>
+
+FrameSource::FrameSource(int start_frame, int end_frame, int stride, int max_frames)
+    : m_start(std::max(0, start_frame)), m_end(end_frame), m_stride(std::max(1, stride)), m_max_frames(max_frames) {}
+
+bool FrameSource::open(const std::string& video_path) {
+    m_position = 0;
+    m_returned = 0;
+    if (!m_cap.open(video_path)) return false;
+    m_container_frames = std::max(0, (int)m_cap.get(cv::CAP_PROP_FRAME_COUNT));
+
+    // Seeking is only trusted when the backend reports landing exactly on the start; otherwise
+    // reopen so grabbing starts from frame 0 again.
+    if (m_start > 0 && m_cap.set(cv::CAP_PROP_POS_FRAMES, m_start)) {
+        if ((int)m_cap.get(cv::CAP_PROP_POS_FRAMES) == m_start) {
+            m_position = m_start;
+        } else if (!m_cap.open(video_path)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FrameSource::skipTo(int position) {
+    while (m_position < position) {
+        if (!m_cap.grab()) return false;
+        m_position++;
+    }
+    return true;
+}
+
+bool FrameSource::read(cv::Mat& frame) {
+    if (m_returned >= m_max_frames) return false;
+    int next = m_start + m_returned * m_stride;
+    if (m_end > 0 && next >= m_end) return false;
+    if (!skipTo(next)) return false;
+    if (!m_cap.read(frame)) return false;
+    m_position++;
+    m_returned++;
+    return true;
+}
+
+int FrameSource::expectedFrames() const {
+    int end = m_container_frames;
+    if (m_end > 0) end = end > 0 ? std::min(end, m_end) : m_end;
+    if (end <= 0) return m_max_frames;
+    int selected = end > m_start ? (end - m_start + m_stride - 1) / m_stride : 0;
+    return std::min(selected, m_max_frames);
+}
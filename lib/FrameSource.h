@@ -0,0 +1,34 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <string>
+
+// Reads the frames selected by a start/end/stride range from a video. Frames skipped by the
+// stride are only grab()bed, never retrieve()d, so they are not converted to BGR; the start is
+// reached by seeking when the backend lands exactly on it, and by grabbing otherwise.
+class FrameSource {
+public:
+    // end_frame <= 0 reads to the end of the video; max_frames caps the frames returned.
+    FrameSource(int start_frame, int end_frame, int stride, int max_frames);
+
+    bool open(const std::string& video_path);
+    bool isOpened() const { return m_cap.isOpened(); }
+    bool read(cv::Mat& frame);
+    void release() { m_cap.release(); }
+
+    // Number of frames read() will return, from the container's frame count; max_frames when
+    // the container does not report one.
+    int expectedFrames() const;
+
+private:
+    bool skipTo(int position);
+
+    cv::VideoCapture m_cap;
+    int m_start;
+    int m_end;
+    int m_stride;
+    int m_max_frames;
+    int m_position = 0;     // index of the next frame grab() would return
+    int m_returned = 0;
+    int m_container_frames = 0;
+};
@@ -0,0 +1,63 @@
+#include "FrameStore.h"
+
+#include <algorithm>
+
+static size_t alignedBytes(size_t bytes) {
+    return (bytes + 63) & ~(size_t)63;
+}
+
+void FrameStore::allocate(int capacity, const cv::Size& size) {
+    clear();
+    m_size = size;
+    const size_t color_stride = alignedBytes((size_t)size.area() * 3);
+    const size_t gray_stride = alignedBytes((size_t)size.area());
+    // Shaped as 64-byte rows so clips of several gigabytes stay within cv::Mat's int dimensions.
+    // cv::Mat data is 64-byte aligned, so every frame starts on a 64-byte boundary too.
+    m_arena.create((int)(capacity * (color_stride + gray_stride) / 64), 64, CV_8U);
+
+    uchar* color_data = m_arena.data;
+    uchar* gray_data = color_data + capacity * color_stride;
+    for (int i = 0; i < capacity; ++i) {
+        m_color.emplace_back(size, CV_8UC3, color_data + i * color_stride);
+        m_gray.emplace_back(size, CV_8UC1, gray_data + i * gray_stride);
+    }
+}
+
+void FrameStore::reserve(int capacity) {
+    if (capacity <= (int)m_color.size() || m_arena.empty()) return;
+    FrameStore grown;
+    grown.allocate(capacity, m_size);
+    for (size_t i = 0; i < m_color.size(); ++i) {
+        m_color[i].copyTo(grown.m_color[i]);
+        m_gray[i].copyTo(grown.m_gray[i]);
+    }
+    m_arena = grown.m_arena;
+    m_color.swap(grown.m_color);
+    m_gray.swap(grown.m_gray);
+}
+
+void FrameStore::assignViews(const std::vector<cv::Mat>& frames_color, const std::vector<cv::Mat>& frames_gray) {
+    clear();
+    m_color = frames_color;
+    m_gray = frames_gray;
+}
+
+void FrameStore::truncate(int count) {
+    count = std::max(0, std::min(count, (int)m_color.size()));
+    m_color.resize(count);
+    m_gray.resize(count);
+}
+
+void FrameStore::clear() {
+    m_color.clear();
+    m_gray.clear();
+    m_arena.release();
+}
+
+size_t FrameStore::bytes() const {
+    if (!m_arena.empty()) return m_arena.total();
+    size_t total = 0;
+    for (const auto& f : m_color) total += f.total() * f.elemSize();
+    for (const auto& f : m_gray) total += f.total() * f.elemSize();
+    return total;
+}
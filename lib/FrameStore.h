@@ -0,0 +1,42 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// The loaded frames of a clip in one contiguous arena: every color frame back to back, then
+// every gray frame, each starting on a 64-byte boundary at a fixed stride. It is allocated
+// for an expected capacity and frame size, and only reallocated by reserve() when more frames
+// arrive. Frames are cv::Mat headers into it, so writing into color(i)/gray(i) with a
+// matching size and type fills the arena in place.
+//
+// Alternatively the store can view frames owned elsewhere, such as a mapped frame cache,
+// which is already laid out the same way.
+class FrameStore {
+public:
+    void allocate(int capacity, const cv::Size& size);
+    // Moves the arena to a larger one of the given capacity, copying every frame held. Headers
+    // taken from color()/gray() before the call no longer point into the store.
+    void reserve(int capacity);
+    // The owner of the frames must keep them alive while the store views them.
+    void assignViews(const std::vector<cv::Mat>& frames_color, const std::vector<cv::Mat>& frames_gray);
+    // Keeps the first count frames; the arena itself is not reallocated.
+    void truncate(int count);
+    void clear();
+
+    int capacity() const { return (int)m_color.size(); }
+    size_t size() const { return m_color.size(); }
+    bool empty() const { return m_color.empty(); }
+    // Bytes owned by the arena, or viewed when the frames live elsewhere.
+    size_t bytes() const;
+
+    cv::Mat& color(size_t i) { return m_color[i]; }
+    cv::Mat& gray(size_t i) { return m_gray[i]; }
+    const std::vector<cv::Mat>& colorFrames() const { return m_color; }
+    const std::vector<cv::Mat>& grayFrames() const { return m_gray; }
+
+private:
+    cv::Mat m_arena;
+    cv::Size m_size;
+    std::vector<cv::Mat> m_color;
+    std::vector<cv::Mat> m_gray;
+};
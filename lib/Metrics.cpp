@@ -0,0 +1,24 @@
+#include "Metrics.h"
+#include <opencv2/opencv.hpp>
+
+std::string SA_Metrics::toJson() const {
+    cv::FileStorage fs(".json", cv::FileStorage::WRITE | cv::FileStorage::MEMORY | cv::FileStorage::FORMAT_JSON);
+    fs << "load_ms" << load_ms;
+    fs << "frames_processed" << frames_processed;
+    fs << "resident_frame_bytes" << (double)resident_frame_bytes;
+
+    fs << "stages" << "[";
+    for (const auto& stage : stages) {
+        fs << "{" << "name" << stage.name << "start_ms" << stage.start_ms << "duration_ms" << stage.duration_ms << "}";
+    }
+    fs << "]";
+
+    fs << "template_tracking_ms" << "[";
+    for (double ms : template_tracking_ms) fs << ms;
+    fs << "]";
+
+    fs << "match_latency_ms" << "[";
+    for (float ms : match_latency_ms) fs << ms;
+    fs << "]";
+    return fs.releaseAndGetString();
+}
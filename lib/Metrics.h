@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+struct SA_StageTiming {
+    std::string name;
+    double start_ms = 0.0;
+    double duration_ms = 0.0;
+};
+
+// Timings of the last loadVideo() followed by the last process(). Stage starts share one
+// axis: process() stages begin where loadVideo() ended, so the two read as one timeline.
+// Stages that interleave frame by frame (decode, resize/rotate, tracking, accumulation while
+// streaming) are reported as their summed time, laid out back to back in the span they share.
+// Stages that run concurrently (pipelined decode and preprocessing in loadVideo()) keep their
+// measured starts and overlap: decode starts at its first read and reports its read time,
+// preprocessing spans from the first frame a worker picks up to the last one finished.
+struct SA_Metrics {
+    std::vector<SA_StageTiming> stages;
+    size_t load_stage_count = 0;
+    double load_ms = 0.0;
+    int frames_processed = 0;
+    size_t resident_frame_bytes = 0;
+    std::vector<double> template_tracking_ms;   // summed match time per template, across threads
+    std::vector<float> match_latency_ms;        // per frame, mean time of one template match
+
+    std::string toJson() const;
+};
+
+typedef std::chrono::steady_clock SA_Clock;
+
+inline double elapsedMs(const SA_Clock::time_point& since) {
+    return std::chrono::duration<double, std::milli>(SA_Clock::now() - since).count();
+}
@@ -0,0 +1,124 @@
+#include "NCCTemplate.h"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// Scalar cross-correlation of the output columns [x_begin, out_cols), used for the row tails
+// the SIMD loop leaves and on targets without 128-bit SIMD.
+template <int N>
+static void crossCorrelateTail(const cv::Mat& image, const uchar* templ, int y, int x_begin, int* acc) {
+    const int out_cols = image.cols - N + 1;
+    for (int x = x_begin; x < out_cols; ++x) {
+        int sum = 0;
+        for (int r = 0; r < N; ++r) {
+            const uchar* src = image.ptr<uchar>(y + r) + x;
+            const uchar* t = templ + r * N;
+            for (int c = 0; c < N; ++c) sum += t[c] * src[c];
+        }
+        acc[x] = sum;
+    }
+}
+
+// Eight output columns at a time, held in two int32x4 registers for the whole template. Taps
+// are consumed in pairs: the two pixel runs they multiply are widened to int16 and interleaved,
+// so one v_dotprod per four outputs multiplies and adds both taps (pmaddwd on SSE2, vmlal on
+// NEON). Pixels and taps are at most 255, so reading them as int16 lanes is exact. N is fixed at
+// compile time, which unrolls the tap loops. Only the 128-bit intrinsics used here are relied
+// on, as they have kept the same signatures across the OpenCV 4.x releases this tree builds with.
+template <int N>
+static void crossCorrelate(const cv::Mat& image, const uchar* templ, cv::Mat& cross) {
+    static_assert(N % 2 == 0, "taps are consumed two at a time");
+    const int out_rows = image.rows - N + 1;
+    const int out_cols = image.cols - N + 1;
+    cross.create(out_rows, out_cols, CV_32S);
+
+#if CV_SIMD128
+    // Tap pairs packed as (t[c], t[c + 1]) int16 lanes of one int32, broadcast per use.
+    int tap_pairs[N * N / 2];
+    for (int k = 0; k < N * N / 2; ++k) tap_pairs[k] = (int)templ[2 * k] | ((int)templ[2 * k + 1] << 16);
+#endif
+    for (int y = 0; y < out_rows; ++y) {
+        int* acc = cross.ptr<int>(y);
+        int x = 0;
+#if CV_SIMD128
+        for (; x + 8 <= out_cols; x += 8) {
+            cv::v_int32x4 sum_lo = cv::v_setall_s32(0), sum_hi = cv::v_setall_s32(0);
+            for (int r = 0; r < N; ++r) {
+                const uchar* src = image.ptr<uchar>(y + r) + x;
+                const int* pairs = tap_pairs + r * (N / 2);
+                for (int c = 0; c < N; c += 2) {
+                    cv::v_uint16x8 a = cv::v_load_expand(src + c), b = cv::v_load_expand(src + c + 1);
+                    cv::v_uint16x8 ab_lo, ab_hi;
+                    cv::v_zip(a, b, ab_lo, ab_hi);
+                    cv::v_int16x8 taps = cv::v_reinterpret_as_s16(cv::v_setall_s32(pairs[c / 2]));
+                    sum_lo = cv::v_dotprod(cv::v_reinterpret_as_s16(ab_lo), taps, sum_lo);
+                    sum_hi = cv::v_dotprod(cv::v_reinterpret_as_s16(ab_hi), taps, sum_hi);
+                }
+            }
+            cv::v_store(acc + x, sum_lo);
+            cv::v_store(acc + x + 4, sum_hi);
+        }
+#endif
+        crossCorrelateTail<N>(image, templ, y, x, acc);
+    }
+}
+
+NCCTemplate::NCCTemplate(const cv::Mat& template_image) {
+    m_template = template_image.clone();
+    if (m_template.type() != CV_8UC1) return;
+
+    const double n = (double)m_template.total();
+    m_sum = cv::sum(m_template)[0];
+    m_norm = std::sqrt(std::max(0.0, m_template.dot(m_template) - m_sum * m_sum / n));
+
+    if (m_template.rows == m_template.cols) {
+        switch (m_template.cols) {
+            case 16: m_kernel = crossCorrelate<16>; break;
+            case 24: m_kernel = crossCorrelate<24>; break;
+            case 32: m_kernel = crossCorrelate<32>; break;
+            case 48: m_kernel = crossCorrelate<48>; break;
+            case 64: m_kernel = crossCorrelate<64>; break;
+            default: break;
+        }
+    }
+}
+
+void NCCTemplate::match(const cv::Mat& image, cv::Mat& correlation_map) const {
+    if (!m_kernel || image.type() != CV_8UC1 || image.rows < m_template.rows || image.cols < m_template.cols) {
+        cv::matchTemplate(image, m_template, correlation_map, cv::TM_CCOEFF_NORMED);
+        return;
+    }
+
+    cv::Mat cross, sum, sqsum;
+    m_kernel(image, m_template.data, cross);
+    cv::integral(image, sum, sqsum, CV_32S, CV_64F);
+
+    const int n_side = m_template.rows;
+    const double n = (double)m_template.total();
+    correlation_map.create(cross.size(), CV_32F);
+    for (int y = 0; y < cross.rows; ++y) {
+        const int* c = cross.ptr<int>(y);
+        const int* s_top = sum.ptr<int>(y);
+        const int* s_bottom = sum.ptr<int>(y + n_side);
+        const double* q_top = sqsum.ptr<double>(y);
+        const double* q_bottom = sqsum.ptr<double>(y + n_side);
+        float* out = correlation_map.ptr<float>(y);
+        for (int x = 0; x < cross.cols; ++x) {
+            double window_sum = s_bottom[x + n_side] - s_bottom[x] - s_top[x + n_side] + s_top[x];
+            double window_sqsum = q_bottom[x + n_side] - q_bottom[x] - q_top[x + n_side] + q_top[x];
+            double window_var = window_sqsum - window_sum * window_sum / n;
+            double num = c[x] - m_sum * window_sum / n;
+            // Same rounding guard and near-flat handling as cv::matchTemplate.
+            double denom = window_var > std::min(0.5, 10 * FLT_EPSILON * window_sqsum) ? std::sqrt(window_var) * m_norm : 0.0;
+            if (std::fabs(num) < denom) {
+                out[x] = (float)(num / denom);
+            } else if (std::fabs(num) < denom * 1.125) {
+                out[x] = num > 0 ? 1.0f : -1.0f;
+            } else {
+                out[x] = 0.0f;
+            }
+        }
+    }
+}
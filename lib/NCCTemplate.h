@@ -0,0 +1,31 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+// A CV_8U template prepared for repeated TM_CCOEFF_NORMED matching. Its sum and zero-mean norm
+// are computed once; each match() only needs the image's window sums, taken from integral
+// images, and the raw cross-correlation. For square templates of 16, 24, 32, 48 or 64 px the
+// cross-correlation runs a kernel specialized for that size, written with OpenCV's 128-bit
+// universal intrinsics in integer arithmetic. Other sizes and types go through cv::matchTemplate.
+class NCCTemplate {
+public:
+    NCCTemplate() = default;
+    explicit NCCTemplate(const cv::Mat& template_image);
+
+    // Writes the CV_32F correlation map, image.rows - rows + 1 by image.cols - cols + 1.
+    void match(const cv::Mat& image, cv::Mat& correlation_map) const;
+
+    const cv::Mat& image() const { return m_template; }
+    int cols() const { return m_template.cols; }
+    int rows() const { return m_template.rows; }
+    bool specialized() const { return m_kernel != nullptr; }
+
+private:
+    // Raw sum of template * image for every placement, CV_32S.
+    using CrossKernel = void (*)(const cv::Mat& image, const uchar* templ, cv::Mat& cross);
+
+    cv::Mat m_template;     // continuous copy
+    double m_sum = 0.0;
+    double m_norm = 0.0;    // sqrt(sum((T - mean(T))^2))
+    CrossKernel m_kernel = nullptr;
+};
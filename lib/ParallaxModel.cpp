@@ -0,0 +1,51 @@
+#include "ParallaxModel.h"
+
+bool ParallaxModel::fit(const std::vector<std::vector<cv::Point2f>>& tracks) {
+    m_base.clear();
+    m_direction.clear();
+    m_template_parallax.clear();
+    m_min_parallax = m_max_parallax = 0.0f;
+    if (tracks.empty() || tracks[0].empty()) return false;
+
+    const auto& base = tracks[0];
+    size_t reference = 0;
+    double best_energy = 0.0;
+    for (size_t t = 1; t < tracks.size(); ++t) {
+        if (tracks[t].size() != base.size()) return false;
+        double energy = 0.0;
+        for (size_t i = 0; i < base.size(); ++i) {
+            cv::Point2f d = tracks[t][i] - base[i];
+            energy += d.dot(d);
+        }
+        if (energy > best_energy) {
+            best_energy = energy;
+            reference = t;
+        }
+    }
+
+    m_base = base;
+    m_direction.assign(base.size(), cv::Point2f(0, 0));
+    if (reference != 0) {
+        for (size_t i = 0; i < base.size(); ++i) m_direction[i] = tracks[reference][i] - base[i];
+    }
+
+    for (const auto& track : tracks) {
+        double num = 0.0;
+        for (size_t i = 0; i < base.size(); ++i) num += (track[i] - base[i]).dot(m_direction[i]);
+        float parallax = best_energy > 0.0 ? (float)(num / best_energy) : 0.0f;
+        m_template_parallax.push_back(parallax);
+    }
+    m_min_parallax = *std::min_element(m_template_parallax.begin(), m_template_parallax.end());
+    m_max_parallax = *std::max_element(m_template_parallax.begin(), m_template_parallax.end());
+    return true;
+}
+
+cv::Point2f ParallaxModel::shiftAt(float parallax, size_t frame) const {
+    return m_base[frame] + m_direction[frame] * parallax;
+}
+
+std::vector<cv::Point2f> ParallaxModel::trackAt(float parallax) const {
+    std::vector<cv::Point2f> track(m_base.size());
+    for (size_t i = 0; i < m_base.size(); ++i) track[i] = shiftAt(parallax, i);
+    return track;
+}
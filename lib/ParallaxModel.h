@@ -0,0 +1,31 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Per-frame camera motion fitted from the template shift tracks. The shift of a scene point
+// with relative parallax p in frame i is modeled as
+//     shift(p, i) = base[i] + p * direction[i]
+// where base is template 0's track (p = 0) and direction is the track of the template that
+// moves most relative to it (p = 1). Every other template gets the p that best explains its
+// track in the least-squares sense, which places all templates on one continuous focal axis.
+class ParallaxModel {
+public:
+    bool fit(const std::vector<std::vector<cv::Point2f>>& tracks);
+    bool isValid() const { return !m_base.empty(); }
+
+    size_t frameCount() const { return m_base.size(); }
+    cv::Point2f shiftAt(float parallax, size_t frame) const;
+    std::vector<cv::Point2f> trackAt(float parallax) const;
+
+    float templateParallax(size_t template_index) const { return m_template_parallax[template_index]; }
+    float minParallax() const { return m_min_parallax; }
+    float maxParallax() const { return m_max_parallax; }
+
+private:
+    std::vector<cv::Point2f> m_base;
+    std::vector<cv::Point2f> m_direction;
+    std::vector<float> m_template_parallax;
+    float m_min_parallax = 0.0f;
+    float m_max_parallax = 0.0f;
+};
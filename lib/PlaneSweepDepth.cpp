@@ -0,0 +1,197 @@
+#include "PlaneSweepDepth.h"
+
+// Adds the bilinear sample of src at (x, y) + shift to sum/sumsq/count for every pixel of
+// region (frame coordinates). The buffers are CV_32F and cover region exactly. Since the shift
+// is a pure translation, the bilinear weights are the same for the whole region and the inner
+// loop is a straight multiply-add the compiler vectorizes.
+static void accumulateTranslated(const cv::Mat& src, const cv::Rect& region, const cv::Point2f& shift,
+                                 cv::Mat& sum, cv::Mat& sumsq, cv::Mat& count) {
+    const int ix = cvFloor(shift.x);
+    const int iy = cvFloor(shift.y);
+    const float fx = shift.x - ix;
+    const float fy = shift.y - iy;
+    const float w00 = (1 - fx) * (1 - fy), w01 = fx * (1 - fy), w10 = (1 - fx) * fy, w11 = fx * fy;
+
+    const int x_begin = std::max(region.x, -ix);
+    const int x_end = std::min(region.x + region.width, src.cols - 1 - ix);
+    const int y_begin = std::max(region.y, -iy);
+    const int y_end = std::min(region.y + region.height, src.rows - 1 - iy);
+    if (x_begin >= x_end) return;
+
+    for (int y = y_begin; y < y_end; ++y) {
+        const uchar* r0 = src.ptr<uchar>(y + iy) + ix;
+        const uchar* r1 = src.ptr<uchar>(y + iy + 1) + ix;
+        float* s = sum.ptr<float>(y - region.y) - region.x;
+        float* q = sumsq.ptr<float>(y - region.y) - region.x;
+        float* c = count.ptr<float>(y - region.y) - region.x;
+        for (int x = x_begin; x < x_end; ++x) {
+            float v = w00 * r0[x] + w01 * r0[x + 1] + w10 * r1[x] + w11 * r1[x + 1];
+            s[x] += v;
+            q[x] += v * v;
+            c[x] += 1.0f;
+        }
+    }
+}
+
+// Per-pixel variance of the aligned samples, box-filtered over the cost window. Pixels seen
+// by fewer than two frames get an infinite cost so they never win.
+static void varianceCost(const cv::Mat& sum, const cv::Mat& sumsq, const cv::Mat& count, int radius, cv::Mat& cost) {
+    cost.create(sum.size(), CV_32F);
+    for (int y = 0; y < sum.rows; ++y) {
+        const float* s = sum.ptr<float>(y);
+        const float* q = sumsq.ptr<float>(y);
+        const float* c = count.ptr<float>(y);
+        float* out = cost.ptr<float>(y);
+        for (int x = 0; x < sum.cols; ++x) {
+            float n = std::max(c[x], 1.0f);
+            float mean = s[x] / n;
+            float variance = std::max(0.0f, q[x] / n - mean * mean);
+            out[x] = c[x] >= 2.0f ? variance : 1e12f;
+        }
+    }
+    if (radius > 0) cv::blur(cost, cost, cv::Size(2 * radius + 1, 2 * radius + 1), cv::Point(-1, -1), cv::BORDER_REPLICATE);
+}
+
+// Keeps the lowest cost per pixel and the running total used for the confidence measure.
+static void updateWinner(const cv::Mat& cost, const cv::Rect& inner, int plane,
+                         cv::Mat& best_cost, cv::Mat& total_cost, cv::Mat& depth_index) {
+    for (int y = 0; y < inner.height; ++y) {
+        const float* c = cost.ptr<float>(y + inner.y) + inner.x;
+        float* best = best_cost.ptr<float>(y);
+        float* total = total_cost.ptr<float>(y);
+        uchar* index = depth_index.ptr<uchar>(y);
+        for (int x = 0; x < inner.width; ++x) {
+            total[x] += std::min(c[x], 1e6f);
+            if (c[x] < best[x]) {
+                best[x] = c[x];
+                index[x] = (uchar)plane;
+            }
+        }
+    }
+}
+
+// Confidence is how far the winning cost sits below the mean cost across planes.
+static void writeConfidence(const cv::Mat& best_cost, const cv::Mat& total_cost, int num_planes, cv::Mat& confidence) {
+    for (int y = 0; y < best_cost.rows; ++y) {
+        const float* best = best_cost.ptr<float>(y);
+        const float* total = total_cost.ptr<float>(y);
+        float* out = confidence.ptr<float>(y);
+        for (int x = 0; x < best_cost.cols; ++x) {
+            float mean = total[x] / num_planes;
+            out[x] = mean > 1e-6f ? std::max(0.0f, 1.0f - best[x] / mean) : 0.0f;
+        }
+    }
+}
+
+PlaneSweepDepth::PlaneSweepDepth(const cv::Size& frame_size, int num_planes, int tile_size, int cost_radius, size_t pass_budget_bytes)
+    : m_frame_size(frame_size), m_num_planes(std::max(1, std::min(num_planes, 256))),
+      m_tile_size(tile_size), m_cost_radius(cost_radius) {
+    const size_t plane_bytes = std::max<size_t>(1, 3 * sizeof(float) * (size_t)frame_size.area());
+    m_planes_per_pass = (int)std::max<size_t>(1, std::min<size_t>(m_num_planes, pass_budget_bytes / plane_bytes));
+}
+
+void PlaneSweepDepth::sweep(const std::vector<cv::Mat>& frames_gray, const std::vector<std::vector<cv::Point2f>>& plane_shifts) {
+    m_depth_index = cv::Mat::zeros(m_frame_size, CV_8U);
+    m_confidence = cv::Mat::zeros(m_frame_size, CV_32F);
+
+    const int tiles_x = (m_frame_size.width + m_tile_size - 1) / m_tile_size;
+    const int tiles_y = (m_frame_size.height + m_tile_size - 1) / m_tile_size;
+    const cv::Rect frame_rect(0, 0, m_frame_size.width, m_frame_size.height);
+
+    cv::parallel_for_(cv::Range(0, tiles_x * tiles_y), [&](const cv::Range& range) {
+        cv::Mat sum, sumsq, count, cost, best_cost, total_cost;
+        for (int tile = range.start; tile < range.end; ++tile) {
+            cv::Rect inner_rect((tile % tiles_x) * m_tile_size, (tile / tiles_x) * m_tile_size, m_tile_size, m_tile_size);
+            inner_rect &= frame_rect;
+            // The cost window needs a halo so box filtering at tile edges sees real neighbors.
+            cv::Rect outer_rect(inner_rect.x - m_cost_radius, inner_rect.y - m_cost_radius,
+                                inner_rect.width + 2 * m_cost_radius, inner_rect.height + 2 * m_cost_radius);
+            outer_rect &= frame_rect;
+            cv::Rect inner_in_outer(inner_rect.tl() - outer_rect.tl(), inner_rect.size());
+
+            best_cost.create(inner_rect.size(), CV_32F);
+            best_cost.setTo(cv::Scalar(std::numeric_limits<float>::max()));
+            total_cost = cv::Mat::zeros(inner_rect.size(), CV_32F);
+            cv::Mat depth_tile = m_depth_index(inner_rect);
+
+            for (int k = 0; k < m_num_planes; ++k) {
+                sum = cv::Mat::zeros(outer_rect.size(), CV_32F);
+                sumsq = cv::Mat::zeros(outer_rect.size(), CV_32F);
+                count = cv::Mat::zeros(outer_rect.size(), CV_32F);
+                for (size_t i = 0; i < frames_gray.size(); ++i) {
+                    accumulateTranslated(frames_gray[i], outer_rect, plane_shifts[k][i], sum, sumsq, count);
+                }
+                varianceCost(sum, sumsq, count, m_cost_radius, cost);
+                updateWinner(cost, inner_in_outer, k, best_cost, total_cost, depth_tile);
+            }
+            cv::Mat confidence_tile = m_confidence(inner_rect);
+            writeConfidence(best_cost, total_cost, m_num_planes, confidence_tile);
+        }
+    });
+}
+
+int PlaneSweepDepth::passCount() const {
+    return (m_num_planes + m_planes_per_pass - 1) / m_planes_per_pass;
+}
+
+void PlaneSweepDepth::accumulate(const cv::Mat& frame_gray, const std::vector<cv::Point2f>& frame_plane_shifts) {
+    const int pass_end = std::min(m_pass_begin + m_planes_per_pass, m_num_planes);
+    if (m_sum.empty()) {
+        for (int k = m_pass_begin; k < pass_end; ++k) {
+            m_sum.push_back(cv::Mat::zeros(m_frame_size, CV_32F));
+            m_sumsq.push_back(cv::Mat::zeros(m_frame_size, CV_32F));
+            m_count.push_back(cv::Mat::zeros(m_frame_size, CV_32F));
+        }
+    }
+
+    const int tiles_x = (m_frame_size.width + m_tile_size - 1) / m_tile_size;
+    const int tiles_y = (m_frame_size.height + m_tile_size - 1) / m_tile_size;
+    const cv::Rect frame_rect(0, 0, m_frame_size.width, m_frame_size.height);
+
+    cv::parallel_for_(cv::Range(0, tiles_x * tiles_y), [&](const cv::Range& range) {
+        for (int tile = range.start; tile < range.end; ++tile) {
+            cv::Rect tile_rect((tile % tiles_x) * m_tile_size, (tile / tiles_x) * m_tile_size, m_tile_size, m_tile_size);
+            tile_rect &= frame_rect;
+            for (int k = m_pass_begin; k < pass_end; ++k) {
+                const int j = k - m_pass_begin;
+                cv::Mat sum = m_sum[j](tile_rect), sumsq = m_sumsq[j](tile_rect), count = m_count[j](tile_rect);
+                accumulateTranslated(frame_gray, tile_rect, frame_plane_shifts[k], sum, sumsq, count);
+            }
+        }
+    });
+}
+
+// Folds the current pass's planes into the running winners and frees their sums.
+void PlaneSweepDepth::finishPass() {
+    if (m_best_cost.empty()) {
+        m_best_cost = cv::Mat(m_frame_size, CV_32F, cv::Scalar(std::numeric_limits<float>::max()));
+        m_total_cost = cv::Mat::zeros(m_frame_size, CV_32F);
+        m_depth_index = cv::Mat::zeros(m_frame_size, CV_8U);
+    }
+    const cv::Rect frame_rect(0, 0, m_frame_size.width, m_frame_size.height);
+    cv::Mat cost;
+    for (size_t j = 0; j < m_sum.size(); ++j) {
+        varianceCost(m_sum[j], m_sumsq[j], m_count[j], m_cost_radius, cost);
+        updateWinner(cost, frame_rect, m_pass_begin + (int)j, m_best_cost, m_total_cost, m_depth_index);
+        m_sum[j].release();
+        m_sumsq[j].release();
+        m_count[j].release();
+    }
+    m_sum.clear();
+    m_sumsq.clear();
+    m_count.clear();
+    m_pass_begin = std::min(m_pass_begin + m_planes_per_pass, m_num_planes);
+}
+
+void PlaneSweepDepth::resolve() {
+    if (!m_sum.empty()) finishPass();
+    m_confidence = cv::Mat::zeros(m_frame_size, CV_32F);
+    if (m_best_cost.empty()) {
+        m_depth_index = cv::Mat::zeros(m_frame_size, CV_8U);
+        return;
+    }
+    writeConfidence(m_best_cost, m_total_cost, m_num_planes, m_confidence);
+    m_best_cost.release();
+    m_total_cost.release();
+    m_pass_begin = 0;
+}
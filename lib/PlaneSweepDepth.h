@@ -0,0 +1,51 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Dense depth by sweeping fronto-parallel parallax planes. For every plane each frame is
+// translated by that plane's per-frame shift and the per-pixel variance across the aligned
+// stack is the matching cost; the plane with the lowest cost wins.
+//
+// sweep() works tile by tile over frames kept in memory, so the cost volume is never held in
+// full. For streaming, accumulate() is fed one frame at a time into per-plane running sums.
+// Those cost three full-frame buffers per plane, so only as many planes as fit in
+// pass_budget_bytes are resident at once: the frames are fed once per pass, finishPass() folds
+// that pass's planes into the running winners and resolve() writes the result after the last.
+class PlaneSweepDepth {
+public:
+    PlaneSweepDepth(const cv::Size& frame_size, int num_planes, int tile_size = 64, int cost_radius = 2,
+                    size_t pass_budget_bytes = size_t(256) << 20);
+
+    // plane_shifts[k][i] is the shift of frame i for plane k.
+    void sweep(const std::vector<cv::Mat>& frames_gray, const std::vector<std::vector<cv::Point2f>>& plane_shifts);
+
+    // Number of times the streaming frames must be fed through accumulate().
+    int passCount() const;
+    // frame_plane_shifts[k] is this frame's shift for plane k, for every plane; only the current
+    // pass's planes are accumulated.
+    void accumulate(const cv::Mat& frame_gray, const std::vector<cv::Point2f>& frame_plane_shifts);
+    void finishPass();
+    void resolve();
+
+    // CV_8U plane index per pixel and CV_32F confidence in [0, 1].
+    const cv::Mat& depthIndex() const { return m_depth_index; }
+    const cv::Mat& confidence() const { return m_confidence; }
+
+private:
+    cv::Size m_frame_size;
+    int m_num_planes;
+    int m_tile_size;
+    int m_cost_radius;
+    int m_planes_per_pass;
+    int m_pass_begin = 0;
+
+    std::vector<cv::Mat> m_sum;
+    std::vector<cv::Mat> m_sumsq;
+    std::vector<cv::Mat> m_count;
+    cv::Mat m_best_cost;
+    cv::Mat m_total_cost;
+
+    cv::Mat m_depth_index;
+    cv::Mat m_confidence;
+};
@@ -0,0 +1,163 @@
+#include "ShiftAccumulate.h"
+
+#include <numeric>
+
+// Bilinear weights are quantized to 1/16 px per axis, so the four weights sum to 256.
+static const int kFixedPointBits = 4;
+static const int kFixedPointOne = 1 << kFixedPointBits;
+static const int kFixedPointScale = kFixedPointOne * kFixedPointOne;
+
+template <typename AccT>
+struct BilinearWeights {
+    AccT w00, w01, w10, w11;
+};
+
+static BilinearWeights<float> makeWeights(float fx, float fy, int frame_weight, float) {
+    float k = (float)frame_weight;
+    return { k * (1 - fx) * (1 - fy), k * fx * (1 - fy), k * (1 - fx) * fy, k * fx * fy };
+}
+
+static BilinearWeights<int> makeWeights(float fx, float fy, int frame_weight, int) {
+    int wx = cvRound(fx * kFixedPointOne);
+    int wy = cvRound(fy * kFixedPointOne);
+    return { frame_weight * (kFixedPointOne - wx) * (kFixedPointOne - wy), frame_weight * wx * (kFixedPointOne - wy),
+             frame_weight * (kFixedPointOne - wx) * wy, frame_weight * wx * wy };
+}
+
+// Adds frame into the output pixels of region. Accumulator element (0, 0) is output pixel
+// origin, so the accumulator may cover the whole output or just one tile of it.
+template <typename AccT>
+static void accumulateRegion(const cv::Mat& frame, const cv::Point2f& shift, int frame_weight, cv::Mat& accumulator,
+                             const cv::Point& origin, const cv::Rect& region) {
+    const int ix = cvFloor(shift.x);
+    const int iy = cvFloor(shift.y);
+    const BilinearWeights<AccT> w = makeWeights(shift.x - ix, shift.y - iy, frame_weight, AccT());
+    const int width = frame.cols;
+    const int height = frame.rows;
+    const int region_end = region.x + region.width;
+
+    // Output columns of the region whose four taps all fall inside the frame.
+    const int x_begin = std::max(region.x, std::min(region_end, -ix));
+    const int x_end = std::max(x_begin, std::min(region_end, width - 1 - ix));
+
+    auto tap = [&](int sy, int sx, int c) -> AccT {
+        return (sx >= 0 && sx < width && sy >= 0 && sy < height) ? (AccT)frame.ptr<uchar>(sy)[sx * 3 + c] : AccT(0);
+    };
+    auto edge_pixel = [&](AccT* acc, int y, int x) {
+        const int sy = y + iy, sx = x + ix;
+        for (int c = 0; c < 3; ++c) {
+            acc[(x - origin.x) * 3 + c] += w.w00 * tap(sy, sx, c) + w.w01 * tap(sy, sx + 1, c) +
+                                           w.w10 * tap(sy + 1, sx, c) + w.w11 * tap(sy + 1, sx + 1, c);
+        }
+    };
+
+    for (int y = region.y; y < region.y + region.height; ++y) {
+        AccT* acc = accumulator.ptr<AccT>(y - origin.y);
+        const int sy = y + iy;
+        if (sy + 1 < 0 || sy >= height) continue;
+        if (sy < 0 || sy + 1 >= height) {
+            for (int x = region.x; x < region_end; ++x) edge_pixel(acc, y, x);
+            continue;
+        }
+
+        for (int x = region.x; x < x_begin; ++x) edge_pixel(acc, y, x);
+        AccT* a = acc + (x_begin - origin.x) * 3;
+        const uchar* r0 = frame.ptr<uchar>(sy) + (x_begin + ix) * 3;
+        const uchar* r1 = frame.ptr<uchar>(sy + 1) + (x_begin + ix) * 3;
+        for (int j = 0; j < (x_end - x_begin) * 3; ++j) {
+            a[j] += w.w00 * r0[j] + w.w01 * r0[j + 3] + w.w10 * r1[j] + w.w11 * r1[j + 3];
+        }
+        for (int x = x_end; x < region_end; ++x) edge_pixel(acc, y, x);
+    }
+}
+
+static void accumulateRegionDispatch(const cv::Mat& frame, const cv::Point2f& shift, int frame_weight, cv::Mat& accumulator,
+                                     const cv::Point& origin, const cv::Rect& region) {
+    CV_Assert(frame.type() == CV_8UC3);
+    if (accumulator.type() == CV_32SC3) {
+        accumulateRegion<int>(frame, shift, frame_weight, accumulator, origin, region);
+    } else {
+        CV_Assert(accumulator.type() == CV_32FC3);
+        accumulateRegion<float>(frame, shift, frame_weight, accumulator, origin, region);
+    }
+}
+
+static double meanScale(int accumulator_type, int total_weight) {
+    double scale = 1.0 / std::max(1, total_weight);
+    if (accumulator_type == CV_32SC3) scale /= kFixedPointScale;
+    return scale;
+}
+
+cv::Mat createShiftAccumulator(const cv::Size& size, bool fixed_point) {
+    return cv::Mat::zeros(size, fixed_point ? CV_32SC3 : CV_32FC3);
+}
+
+void accumulateShiftedFrame(const cv::Mat& frame, const cv::Point2f& shift, cv::Mat& accumulator) {
+    CV_Assert(frame.size() == accumulator.size());
+    cv::parallel_for_(cv::Range(0, frame.rows), [&](const cv::Range& rows) {
+        accumulateRegionDispatch(frame, shift, 1, accumulator, cv::Point(0, 0), cv::Rect(0, rows.start, frame.cols, rows.size()));
+    });
+}
+
+void accumulateShiftedFrameRows(const cv::Mat& frame, const cv::Point2f& shift, int weight, cv::Mat& accumulator, int first_row) {
+    CV_Assert(frame.cols == accumulator.cols && first_row >= 0 && first_row + accumulator.rows <= frame.rows);
+    cv::parallel_for_(cv::Range(0, accumulator.rows), [&](const cv::Range& rows) {
+        accumulateRegionDispatch(frame, shift, weight, accumulator, cv::Point(0, first_row),
+                                 cv::Rect(0, first_row + rows.start, frame.cols, rows.size()));
+    });
+}
+
+void accumulateShiftedFrames(const std::vector<cv::Mat>& frames, const std::vector<cv::Point2f>& shifts, cv::Mat& accumulator,
+                             const std::vector<int>& weights) {
+    CV_Assert(weights.empty() || weights.size() == frames.size());
+    for (const auto& frame : frames) CV_Assert(frame.size() == accumulator.size());
+    // Bands of 16 rows keep the accumulator slice in cache while every frame is added to it.
+    const int band_rows = 16;
+    const int num_bands = (accumulator.rows + band_rows - 1) / band_rows;
+    cv::parallel_for_(cv::Range(0, num_bands), [&](const cv::Range& bands) {
+        for (int band = bands.start; band < bands.end; ++band) {
+            const int y0 = band * band_rows;
+            cv::Rect rows(0, y0, accumulator.cols, std::min(accumulator.rows, y0 + band_rows) - y0);
+            for (size_t i = 0; i < frames.size(); ++i) {
+                if (!weights.empty() && weights[i] == 0) continue;
+                accumulateRegionDispatch(frames[i], shifts[i], weights.empty() ? 1 : weights[i], accumulator, cv::Point(0, 0), rows);
+            }
+        }
+    });
+}
+
+void finishShiftedMean(const cv::Mat& accumulator, int total_weight, cv::Mat& out) {
+    accumulator.convertTo(out, CV_8UC3, meanScale(accumulator.type(), total_weight));
+}
+
+void renderShiftedMean(const std::vector<cv::Mat>& frames, const std::vector<cv::Point2f>& shifts, const std::vector<int>& weights,
+                       bool fixed_point, cv::Mat& out) {
+    CV_Assert(!frames.empty() && shifts.size() >= frames.size() && (weights.empty() || weights.size() == frames.size()));
+    const cv::Size size = frames[0].size();
+    for (const auto& frame : frames) CV_Assert(frame.size() == size);
+    const int total_weight = weights.empty() ? (int)frames.size() : std::accumulate(weights.begin(), weights.end(), 0);
+    const int acc_type = fixed_point ? CV_32SC3 : CV_32FC3;
+    const double scale = meanScale(acc_type, total_weight);
+
+    // A 128 x 64 tile accumulator is 96 KB, which stays in L2 while every frame is added to it.
+    const int tile_cols = 128, tile_rows = 64;
+    const int tiles_x = (size.width + tile_cols - 1) / tile_cols;
+    const int tiles_y = (size.height + tile_rows - 1) / tile_rows;
+    out.create(size, CV_8UC3);
+    // Consecutive tiles share source rows, so each worker takes a run of them along a tile row.
+    cv::parallel_for_(cv::Range(0, tiles_x * tiles_y), [&](const cv::Range& tiles) {
+        cv::Mat tile_accumulator(tile_rows, tile_cols, acc_type);
+        for (int t = tiles.start; t < tiles.end; ++t) {
+            cv::Rect tile((t % tiles_x) * tile_cols, (t / tiles_x) * tile_rows, tile_cols, tile_rows);
+            tile &= cv::Rect(0, 0, size.width, size.height);
+            cv::Mat accumulator = tile_accumulator(cv::Rect(0, 0, tile.width, tile.height));
+            accumulator.setTo(cv::Scalar::all(0));
+            for (size_t i = 0; i < frames.size(); ++i) {
+                if (!weights.empty() && weights[i] == 0) continue;
+                accumulateRegionDispatch(frames[i], shifts[i], weights.empty() ? 1 : weights[i], accumulator, tile.tl(), tile);
+            }
+            cv::Mat out_tile = out(tile);
+            accumulator.convertTo(out_tile, CV_8UC3, scale);
+        }
+    });
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Fused translate + bilinear + accumulate for CV_8UC3 frames. Accumulating frame f with shift
+// s adds f(x + s.x, y + s.y) to every output pixel, with zeros outside the frame; that is the
+// same image cv::warpAffine produces for a translation by -s, without the intermediate
+// shifted and converted copies.
+//
+// Accumulators are CV_32FC3, or CV_32SC3 for the fixed-point mode, which quantizes the
+// bilinear weights to 1/16 px and sums integers.
+
+cv::Mat createShiftAccumulator(const cv::Size& size, bool fixed_point);
+
+// Single frame, rows split across threads. Used when frames arrive one at a time.
+void accumulateShiftedFrame(const cv::Mat& frame, const cv::Point2f& shift, cv::Mat& accumulator);
+
+// Single frame into an accumulator that holds only the output rows [first_row, first_row +
+// accumulator.rows), for rendering a large output one band at a time.
+void accumulateShiftedFrameRows(const cv::Mat& frame, const cv::Point2f& shift, int weight, cv::Mat& accumulator, int first_row);
+
+// All frames at once into a caller-owned accumulator, row bands split across threads; each band walks every frame so there
+// is no reduction step and a band's accumulator rows stay in cache. weights, if given, holds an
+// integer weight per frame (frame i counts weights[i] times); empty weighs every frame once.
+void accumulateShiftedFrames(const std::vector<cv::Mat>& frames, const std::vector<cv::Point2f>& shifts, cv::Mat& accumulator,
+                             const std::vector<int>& weights = std::vector<int>());
+
+// Divides by total_weight (the frame count for unweighted accumulation) and converts to CV_8UC3.
+void finishShiftedMean(const cv::Mat& accumulator, int total_weight, cv::Mat& out);
+
+// Mean of the shifted frames straight into a CV_8UC3 image, without a full-size accumulator.
+// The output is cut into small tiles processed in parallel; each tile's accumulator is summed
+// over every frame, reading only the source rows and columns the tile maps to under each
+// shift, then written out. The working set is one tile accumulator per thread plus the source
+// strips it reads, whatever the output size, so frames may also be views into a memory-mapped
+// file paged in as tiles reach them. Same weights as accumulateShiftedFrames.
+void renderShiftedMean(const std::vector<cv::Mat>& frames, const std::vector<cv::Point2f>& shifts, const std::vector<int>& weights,
+                       bool fixed_point, cv::Mat& out);
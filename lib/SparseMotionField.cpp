@@ -0,0 +1,240 @@
+#include "SparseMotionField.h"
+#include "TemplateMatching.h"
+
+#include <algorithm>
+#include <numeric>
+
+static const cv::Size kFlowWindow(21, 21);
+static const int kFlowLevels = 3;
+static const int kMinFeatures = 8;
+static const int kPowerIterations = 20;
+// Corners whose RMS model error exceeds this many times the median are rejected (never below kMinOutlierPx).
+static const float kOutlierFactor = 3.0f;
+static const float kMinOutlierPx = 1.0f;
+static const int kInterpolationNeighbors = 6;
+static const int kReferenceFrames = 8;
+static const int kParallaxSteps = 65;
+static const float kMinTemplateScore = 0.5f;
+
+void SparseMotionField::begin(const cv::Mat& first_gray, int max_features) {
+    clear();
+    m_frame_size = first_gray.size();
+    std::vector<cv::Point2f> corners;
+    double min_distance = std::max(5, std::min(first_gray.cols, first_gray.rows) / 50);
+    cv::goodFeaturesToTrack(first_gray, corners, max_features, 0.01, min_distance);
+    for (const auto& c : corners) m_tracks.push_back({ c });
+    m_alive.assign(corners.size(), true);
+    cv::buildOpticalFlowPyramid(first_gray, m_prev_pyramid, kFlowWindow, kFlowLevels);
+}
+
+void SparseMotionField::addFrame(const cv::Mat& frame_gray) {
+    std::vector<cv::Mat> pyramid;
+    cv::buildOpticalFlowPyramid(frame_gray, pyramid, kFlowWindow, kFlowLevels);
+
+    std::vector<int> ids;
+    std::vector<cv::Point2f> prev, next;
+    for (size_t k = 0; k < m_tracks.size(); ++k) {
+        if (!m_alive[k]) continue;
+        ids.push_back((int)k);
+        prev.push_back(m_tracks[k].back());
+    }
+    if (!prev.empty()) {
+        std::vector<uchar> status;
+        std::vector<float> error;
+        cv::calcOpticalFlowPyrLK(m_prev_pyramid, pyramid, prev, next, status, error, kFlowWindow, kFlowLevels);
+        const cv::Rect2f frame_rect(0.0f, 0.0f, (float)m_frame_size.width, (float)m_frame_size.height);
+        for (size_t j = 0; j < ids.size(); ++j) {
+            if (status[j] && frame_rect.contains(next[j])) {
+                m_tracks[ids[j]].push_back(next[j]);
+            } else {
+                m_alive[ids[j]] = false;
+            }
+        }
+    }
+    m_prev_pyramid.swap(pyramid);
+}
+
+bool SparseMotionField::fit() {
+    m_features.clear();
+    m_feature_parallax.clear();
+    m_camera.clear();
+    m_direction.clear();
+    m_prev_pyramid.clear();
+
+    size_t num_frames = 0;
+    for (const auto& track : m_tracks) num_frames = std::max(num_frames, track.size());
+    std::vector<int> kept;
+    for (size_t k = 0; k < m_tracks.size(); ++k) {
+        if (m_alive[k] && m_tracks[k].size() == num_frames) kept.push_back((int)k);
+    }
+
+    std::vector<cv::Point2f> camera, direction;
+    std::vector<float> parallax;
+    for (int pass = 0; pass < 2; ++pass) {
+        if ((int)kept.size() < kMinFeatures) return false;
+        const size_t num_kept = kept.size();
+        auto shift = [&](size_t j, size_t i) { return m_tracks[kept[j]][i] - m_tracks[kept[j]][0]; };
+
+        camera.assign(num_frames, cv::Point2f(0, 0));
+        for (size_t j = 0; j < num_kept; ++j) {
+            for (size_t i = 0; i < num_frames; ++i) camera[i] += shift(j, i);
+        }
+        for (auto& c : camera) c *= 1.0f / num_kept;
+
+        // Rank-one fit of the residuals by power iteration, seeded with the corner that moves
+        // most relative to the mean, as ParallaxModel picks its reference template.
+        size_t seed = 0;
+        double seed_energy = -1.0;
+        for (size_t j = 0; j < num_kept; ++j) {
+            double energy = 0.0;
+            for (size_t i = 0; i < num_frames; ++i) {
+                cv::Point2f r = shift(j, i) - camera[i];
+                energy += r.dot(r);
+            }
+            if (energy > seed_energy) {
+                seed_energy = energy;
+                seed = j;
+            }
+        }
+        direction.resize(num_frames);
+        for (size_t i = 0; i < num_frames; ++i) direction[i] = shift(seed, i) - camera[i];
+        parallax.assign(num_kept, 0.0f);
+        for (int iteration = 0; iteration < kPowerIterations; ++iteration) {
+            double direction_energy = 0.0;
+            for (const auto& d : direction) direction_energy += d.dot(d);
+            if (direction_energy <= 1e-12) break;
+            double parallax_energy = 0.0;
+            for (size_t j = 0; j < num_kept; ++j) {
+                double num = 0.0;
+                for (size_t i = 0; i < num_frames; ++i) num += (shift(j, i) - camera[i]).dot(direction[i]);
+                parallax[j] = (float)(num / direction_energy);
+                parallax_energy += parallax[j] * parallax[j];
+            }
+            if (parallax_energy <= 1e-12) break;
+            for (size_t i = 0; i < num_frames; ++i) {
+                cv::Point2f sum(0, 0);
+                for (size_t j = 0; j < num_kept; ++j) sum += (shift(j, i) - camera[i]) * parallax[j];
+                direction[i] = sum * (float)(1.0 / parallax_energy);
+            }
+        }
+
+        double spread = 0.0;
+        for (float p : parallax) spread += p * p;
+        spread = std::sqrt(spread / num_kept);
+        if (spread > 1e-6) {
+            for (auto& p : parallax) p = (float)(p / spread);
+            for (auto& d : direction) d *= (float)spread;
+        } else {
+            std::fill(parallax.begin(), parallax.end(), 0.0f);
+            std::fill(direction.begin(), direction.end(), cv::Point2f(0, 0));
+        }
+        if (pass == 1) break;
+
+        std::vector<float> errors(num_kept);
+        for (size_t j = 0; j < num_kept; ++j) {
+            double sum_sq = 0.0;
+            for (size_t i = 0; i < num_frames; ++i) {
+                cv::Point2f e = shift(j, i) - camera[i] - direction[i] * parallax[j];
+                sum_sq += e.dot(e);
+            }
+            errors[j] = (float)std::sqrt(sum_sq / num_frames);
+        }
+        std::vector<float> sorted = errors;
+        std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+        float threshold = std::max(kMinOutlierPx, kOutlierFactor * sorted[sorted.size() / 2]);
+        std::vector<int> inliers;
+        for (size_t j = 0; j < num_kept; ++j) {
+            if (errors[j] <= threshold) inliers.push_back(kept[j]);
+        }
+        kept.swap(inliers);
+    }
+
+    for (int k : kept) m_features.push_back(m_tracks[k][0]);
+    m_feature_parallax = parallax;
+    m_camera = camera;
+    m_direction = direction;
+    m_tracks.clear();
+    m_alive.clear();
+    return true;
+}
+
+void SparseMotionField::clear() {
+    m_prev_pyramid.clear();
+    m_tracks.clear();
+    m_alive.clear();
+    m_features.clear();
+    m_feature_parallax.clear();
+    m_camera.clear();
+    m_direction.clear();
+}
+
+cv::Point2f SparseMotionField::shiftAt(float parallax, size_t frame) const {
+    return m_camera[frame] + m_direction[frame] * parallax;
+}
+
+float SparseMotionField::interpolatedParallax(const cv::Point2f& point) const {
+    std::vector<std::pair<float, float>> nearest;    // (squared distance, parallax)
+    for (size_t k = 0; k < m_features.size(); ++k) {
+        cv::Point2f d = m_features[k] - point;
+        nearest.emplace_back(d.dot(d), m_feature_parallax[k]);
+    }
+    size_t count = std::min(nearest.size(), (size_t)kInterpolationNeighbors);
+    std::partial_sort(nearest.begin(), nearest.begin() + count, nearest.end());
+    double weighted = 0.0, total = 0.0;
+    for (size_t n = 0; n < count; ++n) {
+        double w = 1.0 / (nearest[n].first + 1.0);
+        weighted += w * nearest[n].second;
+        total += w;
+    }
+    return total > 0.0 ? (float)(weighted / total) : 0.0f;
+}
+
+// Zero mean, unit norm, so a dot product of two such patches is their ZNCC.
+static void normalizePatch(cv::Mat& patch) {
+    patch -= cv::mean(patch)[0];
+    double norm = cv::norm(patch);
+    if (norm > 1e-6) patch *= 1.0 / norm;
+}
+
+float SparseMotionField::templateParallax(const std::vector<cv::Mat>& frames_gray, const cv::Mat& template_image, const cv::Point& origin) const {
+    const cv::Size size = template_image.size();
+    const cv::Point2f center(origin.x + (size.width - 1) * 0.5f, origin.y + (size.height - 1) * 0.5f);
+    const float fallback = interpolatedParallax(center);
+    const size_t num_frames = std::min(frames_gray.size(), m_camera.size());
+    if (num_frames < 2) return fallback;
+
+    cv::Mat templ;
+    template_image.convertTo(templ, CV_32F);
+    normalizePatch(templ);
+
+    std::vector<size_t> references;
+    int num_references = std::min(kReferenceFrames, (int)num_frames - 1);
+    for (int r = 1; r <= num_references; ++r) references.push_back((size_t)r * (num_frames - 1) / num_references);
+
+    // Scan slightly beyond the corners' range, as the dense sweep does for templates.
+    float lo = *std::min_element(m_feature_parallax.begin(), m_feature_parallax.end());
+    float hi = *std::max_element(m_feature_parallax.begin(), m_feature_parallax.end());
+    float margin = std::max(0.5f, 0.25f * (hi - lo));
+    lo -= margin;
+    hi += margin;
+    const float step = (hi - lo) / (kParallaxSteps - 1);
+
+    cv::Mat scores(1, kParallaxSteps, CV_32F);
+    cv::Mat patch;
+    for (int s = 0; s < kParallaxSteps; ++s) {
+        float p = lo + step * s;
+        double score = 0.0;
+        for (size_t i : references) {
+            cv::getRectSubPix(frames_gray[i], size, center + shiftAt(p, i), patch, CV_32F);
+            normalizePatch(patch);
+            score += templ.dot(patch);
+        }
+        scores.at<float>(0, s) = (float)(score / references.size());
+    }
+
+    double best_score;
+    cv::Point best;
+    cv::minMaxLoc(scores, nullptr, &best_score, nullptr, &best);
+    if (best_score < kMinTemplateScore) return fallback;
+    return lo + step * refinePeakSubpixel(scores, best).x;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Camera motion estimated once from sparse corners and shared by every depth query. Corners
+// found in frame 0 are followed frame to frame with pyramidal Lucas-Kanade, each frame's
+// pyramid being built once; a corner lost in any frame is dropped. fit() then explains the
+// surviving shift tracks with the same rank-one model ParallaxModel uses for templates,
+//     shift_k(i) = camera[i] + parallax_k * direction[i]
+// with the corner parallaxes normalized to zero mean and unit spread. Corners the model fits
+// poorly (independently moving objects, LK failures) are rejected and the fit is repeated.
+//
+// A template then needs no per-frame search: templateParallax() finds its parallax by a 1-D
+// search along the model in a few frames, and shiftAt() gives its whole track.
+class SparseMotionField {
+public:
+    void begin(const cv::Mat& first_gray, int max_features = 500);
+    void addFrame(const cv::Mat& frame_gray);
+    // False, leaving the field invalid, when too few corners survive.
+    bool fit();
+    void clear();
+    bool isValid() const { return !m_camera.empty(); }
+
+    size_t frameCount() const { return m_camera.size(); }
+    size_t featureCount() const { return m_features.size(); }
+    cv::Point2f shiftAt(float parallax, size_t frame) const;
+
+    // Parallax at a frame-0 pixel, interpolated from the nearest corners by inverse squared distance.
+    float interpolatedParallax(const cv::Point2f& point) const;
+    // Parallax of the template cut from frame 0 at origin, scored by ZNCC against frames_gray
+    // (the frames the field was built from). Falls back to interpolatedParallax() when no
+    // candidate matches well, as for textureless templates.
+    float templateParallax(const std::vector<cv::Mat>& frames_gray, const cv::Mat& template_image, const cv::Point& origin) const;
+
+private:
+    std::vector<cv::Mat> m_prev_pyramid;
+    cv::Size m_frame_size;
+    std::vector<std::vector<cv::Point2f>> m_tracks;    // per corner, its position in every frame so far
+    std::vector<bool> m_alive;
+
+    std::vector<cv::Point2f> m_features;    // frame-0 positions of the corners kept by fit()
+    std::vector<float> m_feature_parallax;
+    std::vector<cv::Point2f> m_camera;
+    std::vector<cv::Point2f> m_direction;
+};
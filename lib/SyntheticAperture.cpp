@@ -1,72 +1,330 @@
 #include "SyntheticAperture.h"
+#include "TemplateMatching.h"
+#include "PlaneSweepDepth.h"
+#include "ShiftAccumulate.h"
+#include "BoundedQueue.h"
+#include "FrameSource.h"
+#include "FrameSelection.h"
+#include <filesystem>
+#include <numeric>
 #include <iostream>
+#include <random>
+#include <thread>
+
+static const std::vector<cv::Point2f> kNoHistory;
+// Accumulator budget for a render that cannot use a render cache.
+static const size_t kRenderBandBytes = size_t(64) << 20;
+
+// Tells apart the temporary render caches of processors sharing the temp directory.
+static std::string randomOwnerToken() {
+    std::random_device rd;
+    return std::to_string(((uint64_t)rd() << 32) | rd());
+}
 
 SyntheticAperture::SyntheticAperture()
-    : m_video_loaded(false), m_is_processed(false), m_status_message("Ready.") {}
+    : m_status_message("Ready."), m_progress_done(0), m_progress_total(0), m_cancel_requested(false),
+      m_snapshot(std::make_shared<SA_Snapshot>()), m_video_loaded(false), m_is_processed(false),
+      m_render_cache_owner(randomOwnerToken()) {}
+
+SyntheticAperture::~SyntheticAperture() {
+    releaseRenderCache();
+}
 
 bool SyntheticAperture::loadVideo(const std::string& video_path, const SA_Parameters& params) {
-    m_status_message = "Loading video...";
+    m_cancel_requested = false;
+    bool ok = loadVideoFrames(video_path, params);
+    publishSnapshot();
+    setStage(ok ? "Loaded" : "Stopped", 0);
+    return ok;
+}
+
+bool SyntheticAperture::loadVideoFrames(const std::string& video_path, const SA_Parameters& params) {
+    setStatus("Loading video...");
     std::cout << "--- Step 1: Loading and Preparing Video Frames ---" << std::endl;
     m_video_loaded = false;
     m_is_processed = false;
-    m_frames_gray.clear();
-    m_frames_color.clear();
+    m_active_frames_gray.clear();
+    m_active_frames_color.clear();
+    m_selected_frames.clear();
+    m_frame_weights.clear();
+    m_frame_set.clear();
+    m_frames.clear();
     m_multi_template_shifts.clear();
+    resetMemoizedResults();
     m_parallaxes.clear();
     m_depth_map = cv::Mat();
+    m_depth_index = cv::Mat();
+    m_depth_confidence = cv::Mat();
     m_synthetic_image = cv::Mat();
+    m_first_gray_frame = cv::Mat();
+    m_video_path = video_path;
+    m_load_params = params;
+    m_metrics = SA_Metrics();
+    // load_ms stays 0 until loading ends, so processClockMs() meanwhile measures from the load's start.
+    m_process_start = SA_Clock::now();
+    m_frame_cache.close();
+    releaseRenderCache();
+
+    // The cache only helps when every frame is kept; streaming decodes in process() anyway.
+    std::string cache_key = (params.streaming || params.frame_cache_dir.empty()) ? std::string() : frameCacheKey(video_path, params);
+    std::string cache_path = cache_key.empty() ? std::string() : frameCachePath(params.frame_cache_dir, cache_key);
+    double stage_start = processClockMs();
+    if (!cache_key.empty() && m_frame_cache.open(cache_path, cache_key)) {
+        m_frames.assignViews(m_frame_cache.framesColor(), m_frame_cache.framesGray());
+        addStage("Cache map", stage_start, processClockMs() - stage_start);
+        std::cout << "Mapped " << m_frames.size() << " frames from cache '" << cache_path << "'" << std::endl;
+    } else {
+        // In streaming mode only frame 0 is decoded here; process() decodes the rest.
+        if (!decodeVideoFrames(video_path, params.streaming ? 1 : params.max_frames)) return false;
+        if (!cache_key.empty()) {
+            stage_start = processClockMs();
+            if (!writeFrameCache(cache_path, cache_key, m_frames.colorFrames(), m_frames.grayFrames())) {
+                std::cerr << "Warning: Could not write frame cache '" << cache_path << "'" << std::endl;
+            }
+            addStage("Cache write", stage_start, processClockMs() - stage_start);
+        }
+    }
+
+    m_first_color_frame = m_frames.color(0).clone();
+    m_first_gray_frame = m_frames.gray(0).clone();
+    if (params.streaming) {
+        m_frames.clear();
+        setStatus("Video opened in streaming mode; frames are decoded during processing.");
+    } else {
+        setStatus("Successfully loaded " + std::to_string(m_frames.size()) + " frames.");
+    }
+    m_metrics.load_stage_count = m_metrics.stages.size();
+    m_metrics.load_ms = processClockMs();
+    m_metrics.frames_processed = (int)(params.streaming ? 1 : m_frames.size());
+    m_metrics.resident_frame_bytes = frameStoreBytes();
+
+    m_video_loaded = true;
+    std::cout << getStatusMessage() << "\n" << std::endl;
+    return true;
+}
 
-    cv::VideoCapture cap(video_path);
-    if (!cap.isOpened()) {
-        m_status_message = "FATAL ERROR: Video file not found at '" + video_path + "'";
-        std::cerr << m_status_message << std::endl;
+bool SyntheticAperture::decodeVideoFrames(const std::string& video_path, int frames_to_load) {
+    FrameSource source = selectedFrames(frames_to_load);
+    if (!source.open(video_path)) {
+        setStatus("FATAL ERROR: Video file not found at '" + video_path + "'");
+        std::cerr << getStatusMessage() << std::endl;
         return false;
     }
+    const int expected_frames = source.expectedFrames();
+    setStage("Decoding", expected_frames);
 
-    int frame_count = 0;
-    while (cap.isOpened() && frame_count < params.max_frames) {
-        cv::Mat frame;
-        if (!cap.read(frame)) break;
+    cv::Mat first_frame;
+    const double decode_start = processClockMs();
+    SA_Clock::time_point t0 = SA_Clock::now();
+    if (!source.read(first_frame)) {
+        setStatus("Error: No frames were loaded from the video.");
+        std::cerr << getStatusMessage() << std::endl;
+        return false;
+    }
+    double decode_ms = elapsedMs(t0);
 
-        if (params.override_width > 0 && params.override_height > 0) {
-            cv::resize(frame, frame, cv::Size(params.override_width, params.override_height));
-        }
+    // Frame 0 fixes the target size, so the arena is allocated here for the frames the container
+    // reports, with some slack. Containers can under-report by far more (variable frame rate,
+    // remuxed files), so the arena grows when it fills and frames remain.
+    const cv::Size target = targetFrameSize(first_frame.size(), m_load_params.scale_factor);
+    const int capacity = std::min(frames_to_load, expected_frames + 16);
+    m_frames.allocate(capacity, target);
+    // When preprocessing would not touch the pixels, frames are decoded straight into their slot.
+    const bool decode_in_place = target == first_frame.size() && m_load_params.rotation % 360 == 0;
 
-        if (params.rotation != 0) {
-            cv::Mat rotated_frame;
-            cv::Point2f center((frame.cols - 1) / 2.0, (frame.rows - 1) / 2.0);
-            cv::Mat rot = cv::getRotationMatrix2D(center, params.rotation, 1.0);
-            cv::warpAffine(frame, rotated_frame, rot, frame.size());
-            frame = rotated_frame;
-        }
+    // This thread only decodes and hands frames to the preprocessing workers through a bounded
+    // queue, so decoding overlaps the CPU transforms. Each worker writes into the frame's own
+    // arena slot, which keeps frame order whatever the scheduling. Decode buffers go back to a
+    // free list, so full-resolution frames are not reallocated for every read; it holds every
+    // buffer plus frame 0's, so returning one never blocks. The worker count follows OpenCV's
+    // thread budget, which the batch runner splits between clips.
+    int num_workers = std::max(1, std::min({ cv::getNumThreads() - 1, 8, capacity }));
+    const int queue_depth = 2 * num_workers;
+    const int num_buffers = queue_depth + num_workers + 1;
+    BoundedQueue<std::pair<int, cv::Mat>> queue(queue_depth);
+    BoundedQueue<cv::Mat> free_buffers(num_buffers + 1);
+    for (int b = 0; b < num_buffers; ++b) free_buffers.push(cv::Mat());
 
-        cv::Mat small_color, small_gray;
-        cv::resize(frame, small_color, cv::Size(), 1.0 / params.scale_factor, 1.0 / params.scale_factor);
-        cv::cvtColor(small_color, small_gray, cv::COLOR_BGR2GRAY);
+    // Each worker's first job start and last job end on the load timeline.
+    std::vector<double> worker_start_ms(num_workers, std::numeric_limits<double>::max());
+    std::vector<double> worker_end_ms(num_workers, 0.0);
+    std::vector<std::thread> workers;
+    std::atomic<int> frames_done(0);
+    // A worker that fails keeps draining the queue so the decoder never blocks; the first error wins.
+    std::atomic<bool> failed(false);
+    std::string error;
+    for (int w = 0; w < num_workers; ++w) {
+        workers.emplace_back([&, w]() {
+            std::pair<int, cv::Mat> item;
+            while (queue.pop(item)) {
+                worker_start_ms[w] = std::min(worker_start_ms[w], processClockMs());
+                if (!failed) {
+                    try {
+                        preprocessFrame(item.second, m_frames.color(item.first), m_frames.gray(item.first));
+                    } catch (const std::exception& e) {
+                        if (!failed.exchange(true)) error = e.what();
+                    }
+                }
+                worker_end_ms[w] = processClockMs();
+                // In place, the free list is never drawn from, so nothing goes back to it.
+                if (!decode_in_place) free_buffers.push(item.second);
+                frames_done++;
+                advanceProgress();
+            }
+        });
+    }
 
-        m_frames_gray.push_back(small_gray);
-        m_frames_color.push_back(small_color);
+    queue.push(std::make_pair(0, first_frame));
+    int frame_count = 1;
+    while (frame_count < frames_to_load && !m_cancel_requested && !failed) {
+        // Past the arena's end an in-place frame is decoded into its own Mat and copied once
+        // the arena has grown.
+        const bool has_slot = frame_count < m_frames.capacity();
+        cv::Mat buffer;
+        if (!decode_in_place) {
+            free_buffers.pop(buffer);
+        } else if (has_slot) {
+            buffer = m_frames.color(frame_count);
+        }
+        t0 = SA_Clock::now();
+        bool ok = source.read(buffer);
+        decode_ms += elapsedMs(t0);
+        if (!ok) {
+            if (!decode_in_place) free_buffers.push(buffer);
+            break;
+        }
+        if (!has_slot) {
+            // Growing moves the arena, so every queued frame must be written first.
+            while (frames_done < frame_count && !failed) std::this_thread::yield();
+            m_frames.reserve((int)std::min<long long>(frames_to_load, 2LL * m_frames.capacity()));
+        }
+        queue.push(std::make_pair(frame_count, buffer));
         frame_count++;
     }
-    cap.release();
+    queue.close();
+    for (auto& worker : workers) worker.join();
+    source.release();
 
-    if (m_frames_gray.empty()) {
-        m_status_message = "Error: No frames were loaded from the video.";
-        std::cerr << m_status_message << std::endl;
+    m_frames.truncate(frame_count);
+    if (failed) {
+        setStatus("Error: Could not preprocess a video frame: " + error);
+        std::cerr << getStatusMessage() << std::endl;
         return false;
     }
-
-    m_first_color_frame = m_frames_color[0].clone();
-    m_video_loaded = true;
-    m_status_message = "Successfully loaded " + std::to_string(m_frames_gray.size()) + " frames.";
-    std::cout << m_status_message << "\n" << std::endl;
+    if (checkCancelled()) return false;
+    // Decoding and preprocessing run concurrently, so their bars overlap; preprocessing spans
+    // from the first frame a worker picked up to the last one finished.
+    const double preprocess_start = *std::min_element(worker_start_ms.begin(), worker_start_ms.end());
+    const double preprocess_end = *std::max_element(worker_end_ms.begin(), worker_end_ms.end());
+    addStage("Decode", decode_start, decode_ms);
+    addStage("Resize/rotate", preprocess_start, preprocess_end - preprocess_start);
     return true;
 }
 
+FrameSource SyntheticAperture::selectedFrames(int max_frames) const {
+    return FrameSource(m_load_params.start_frame, m_load_params.end_frame, m_load_params.frame_stride, max_frames);
+}
+
+std::string SyntheticAperture::frameCacheKey(const std::string& video_path, const SA_Parameters& params) const {
+    std::string identity = frameCacheFileIdentity(video_path);
+    if (identity.empty()) return identity;
+    return identity + "|frames=" + std::to_string(params.max_frames) + "|scale=" + std::to_string(params.scale_factor) +
+           "|size=" + std::to_string(params.override_width) + "x" + std::to_string(params.override_height) +
+           "|rotation=" + std::to_string(params.rotation) +
+           "|range=" + std::to_string(params.start_frame) + ":" + std::to_string(params.end_frame) + ":" + std::to_string(params.frame_stride);
+}
+
+// Centers img on a zero canvas of the given size, cropping whatever does not fit.
+static cv::Mat centerOnCanvas(const cv::Mat& img, const cv::Size& size) {
+    cv::Mat canvas = cv::Mat::zeros(size, img.type());
+    int dx = (size.width - img.cols) / 2;
+    int dy = (size.height - img.rows) / 2;
+    cv::Rect dst_rect = cv::Rect(dx, dy, img.cols, img.rows) & cv::Rect(0, 0, size.width, size.height);
+    img(dst_rect - cv::Point(dx, dy)).copyTo(canvas(dst_rect));
+    return canvas;
+}
+
+// Override size, rotation and downscale are composed into one mapping from the decoded frame
+// to the target resolution, so each frame is resampled exactly once. Rotations by multiples of
+// 90 degrees are applied after the resample with transpose/flip, which is lossless; like any
+// other angle they keep the frame size, cropping or padding around the center.
+cv::Size SyntheticAperture::uprightFrameSize(const cv::Size& source) const {
+    const bool override_size = m_load_params.override_width > 0 && m_load_params.override_height > 0;
+    return override_size ? cv::Size(m_load_params.override_width, m_load_params.override_height) : source;
+}
+
+cv::Size SyntheticAperture::targetFrameSize(const cv::Size& source, int scale_factor) const {
+    const cv::Size upright = uprightFrameSize(source);
+    const double inv_scale = 1.0 / scale_factor;
+    return cv::Size(cv::saturate_cast<int>(upright.width * inv_scale), cv::saturate_cast<int>(upright.height * inv_scale));
+}
+
+// color and gray are written in place when they already have the target size and type, which
+// is how the frame store's arena slots are filled.
+void SyntheticAperture::preprocessFrame(const cv::Mat& frame, cv::Mat& color, cv::Mat& gray) const {
+    resampleFrame(frame, color, m_load_params.scale_factor);
+    // Gray is derived from the target-resolution image, so it costs one pass over the output.
+    cv::cvtColor(color, gray, cv::COLOR_BGR2GRAY);
+}
+
+void SyntheticAperture::resampleFrame(const cv::Mat& frame, cv::Mat& color, int scale_factor) const {
+    const cv::Size source = frame.size();
+    const cv::Size upright = uprightFrameSize(source);
+    const cv::Size target = targetFrameSize(source, scale_factor);
+    const double inv_scale = 1.0 / scale_factor;
+    const int angle = ((m_load_params.rotation % 360) + 360) % 360;
+
+    if (angle == 0) {
+        if (target != source) {
+            cv::resize(frame, color, target);
+        } else if (color.data != frame.data) {
+            frame.copyTo(color);
+        }
+    } else if (angle % 90 == 0) {
+        cv::Mat resampled = frame;
+        if (target != source) cv::resize(frame, resampled, target);
+        if (angle == 180) {
+            cv::rotate(resampled, color, cv::ROTATE_180);
+        } else {
+            // Positive angles are counter-clockwise, as in cv::getRotationMatrix2D.
+            cv::Mat rotated;
+            cv::rotate(resampled, rotated, angle == 90 ? cv::ROTATE_90_COUNTERCLOCKWISE : cv::ROTATE_90_CLOCKWISE);
+            centerOnCanvas(rotated, target).copyTo(color);
+        }
+    } else {
+        // Pixel-center convention throughout (x + 0.5 scales, then - 0.5), matching cv::resize.
+        const double kx = (double)upright.width / source.width;
+        const double ky = (double)upright.height / source.height;
+        cv::Matx33d to_upright(kx, 0, 0.5 * kx - 0.5,
+                               0, ky, 0.5 * ky - 0.5,
+                               0, 0, 1);
+        cv::Point2f center((upright.width - 1) / 2.0f, (upright.height - 1) / 2.0f);
+        cv::Mat rot = cv::getRotationMatrix2D(center, angle, 1.0);
+        cv::Matx33d rotate(rot.at<double>(0, 0), rot.at<double>(0, 1), rot.at<double>(0, 2),
+                           rot.at<double>(1, 0), rot.at<double>(1, 1), rot.at<double>(1, 2),
+                           0, 0, 1);
+        cv::Matx33d to_target(inv_scale, 0, 0.5 * inv_scale - 0.5,
+                              0, inv_scale, 0.5 * inv_scale - 0.5,
+                              0, 0, 1);
+        cv::Matx33d m = to_target * rotate * to_upright;
+        cv::Matx23d affine(m(0, 0), m(0, 1), m(0, 2),
+                           m(1, 0), m(1, 1), m(1, 2));
+        cv::warpAffine(frame, color, affine, target, cv::INTER_LINEAR);
+    }
+}
+
 bool SyntheticAperture::process(const SA_Parameters& params) {
+    m_cancel_requested = false;
+    bool ok = runProcess(params);
+    publishSnapshot();
+    setStage(ok ? "Done" : "Stopped", 0);
+    return ok;
+}
+
+bool SyntheticAperture::runProcess(const SA_Parameters& params) {
     if (!m_video_loaded) {
-        m_status_message = "Cannot process. Load a video first.";
-        std::cerr << m_status_message << std::endl;
+        setStatus("Cannot process. Load a video first.");
+        std::cerr << getStatusMessage() << std::endl;
         return false;
     }
 
@@ -74,86 +332,481 @@ bool SyntheticAperture::process(const SA_Parameters& params) {
     m_is_processed = false;
 
     if (m_params.template_points.empty()) {
-        m_status_message = "Error: No templates have been selected.";
-        std::cerr << m_status_message << std::endl;
+        setStatus("Error: No templates have been selected.");
+        std::cerr << getStatusMessage() << std::endl;
         return false;
     }
-    cv::Rect frame_rect(0, 0, m_frames_gray[0].cols, m_frames_gray[0].rows);
+    cv::Rect frame_rect(0, 0, m_first_gray_frame.cols, m_first_gray_frame.rows);
     for(const auto& pt : m_params.template_points) {
         cv::Rect template_rect(pt.x, pt.y, m_params.template_size, m_params.template_size);
         if ((template_rect & frame_rect) != template_rect) {
-            m_status_message = "Error: A template is outside frame boundaries.";
-            std::cerr << m_status_message << std::endl;
+            setStatus("Error: A template is outside frame boundaries.");
+            std::cerr << getStatusMessage() << std::endl;
             return false;
         }
     }
 
-    m_status_message = "Processing... Calculating shifts for all templates.";
+    beginProcessMetrics();
+    if (m_load_params.streaming) {
+        resetMemoizedResults();
+        m_active_frames_gray.clear();
+        m_active_frames_color.clear();
+        m_frame_weights.clear();
+        if (!processStreaming()) return false;
+        m_is_processed = true;
+        setStatus("Processing complete!");
+        return true;
+    }
+
+    setStatus("Processing... Calculating shifts for all templates.");
+    double stage_start = processClockMs();
     calculateMultiTemplateShifts();
+    if (checkCancelled()) return false;
+    m_parallax_model.fit(m_multi_template_shifts);
+    m_focal_parallax = 0.0f;
+    addStage("Tracking", stage_start, processClockMs() - stage_start);
 
-    m_status_message = "Processing... Creating depth map.";
-    createDepthMap();
+    std::string depth_inputs = depthInputsKey();
+    if (depth_inputs != m_depth_inputs) {
+        setStatus("Processing... Creating depth map.");
+        setStage("Depth map", 0);
+        m_depth_inputs.clear();
+        stage_start = processClockMs();
+        if (!createDepthMap() || checkCancelled()) return false;
+        addStage("Depth map", stage_start, processClockMs() - stage_start);
+        m_depth_inputs = depth_inputs;
+    } else {
+        std::cout << "--- Step 4: Depth map inputs unchanged, reusing it ---\n" << std::endl;
+    }
 
-    m_status_message = "Processing... Creating synthetic image (using first template).";
-    createSyntheticImage();
+    std::string synthesis_inputs = synthesisInputsKey();
+    if (synthesis_inputs != m_synthesis_inputs) {
+        setStatus("Processing... Creating synthetic image (using first template).");
+        setStage("Synthesis", 0);
+        m_synthesis_inputs.clear();
+        stage_start = processClockMs();
+        if (!createSyntheticImage()) {
+            checkCancelled();
+            return false;
+        }
+        addStage("Synthesis", stage_start, processClockMs() - stage_start);
+        m_synthesis_inputs = synthesis_inputs;
+    } else {
+        std::cout << "--- Step 5: Synthetic image inputs unchanged, reusing it ---\n" << std::endl;
+    }
 
     m_is_processed = true;
-    m_status_message = "Processing complete!";
+    setStatus("Processing complete!");
     return true;
 }
 
 void SyntheticAperture::calculateMultiTemplateShifts() {
     std::cout << "--- Step 2 & 3: Calculating Pixel Shift for Multiple Templates ---" << std::endl;
-    m_multi_template_shifts.clear();
+    const size_t num_templates = m_params.template_points.size();
+
+    selectFrames();
+    if (m_cancel_requested) return;
+
+    std::vector<size_t> all_templates(num_templates);
+    std::iota(all_templates.begin(), all_templates.end(), 0);
+    std::vector<float> pair_ms;
+    trackTemplates(m_active_frames_gray, m_frame_set, all_templates, m_multi_template_shifts, &pair_ms);
+    if (m_cancel_requested) return;
+    recordMatchLatencies(pair_ms, num_templates, m_tracked_templates.size());
+    std::cout << "Finished calculating all pixel shifts for " << m_multi_template_shifts.size() << " templates.\n" << std::endl;
+}
 
-    int search_margin = (m_params.search_window_size - m_params.template_size) / 2;
+// With selected_frames set, template 0 alone is tracked over every loaded frame first (a single
+// track, memoized like the others). That many frames are kept, spread evenly over its shifts,
+// each weighted by the frames it stands in for; the other templates, the depth map and
+// synthesis only see the kept frames. Otherwise all loaded frames are used, each with weight 1.
+// Streaming mode never calls this, so it ignores selected_frames.
+void SyntheticAperture::selectFrames() {
+    const size_t num_frames = m_frames.size();
+    m_frame_set.clear();
+    m_selected_frames.resize(num_frames);
+    std::iota(m_selected_frames.begin(), m_selected_frames.end(), 0);
+    m_frame_weights.clear();
 
+    const int target = m_params.selected_frames;
+    if (target > 0 && (size_t)target < num_frames) {
+        setStatus("Processing... Selecting frames.");
+        std::vector<std::vector<cv::Point2f>> tracks;
+        trackTemplates(m_frames.grayFrames(), std::string(), { 0 }, tracks, nullptr);
+        if (m_cancel_requested) return;
+        selectViewpoints(tracks[0], target, m_selected_frames, m_frame_weights);
+        m_frame_set = "select=" + std::to_string(target) + "@" + trackKey(0, std::string());
+        // With a tracker that matches frames independently, template 0's track on the selection
+        // is a subset of its full track.
+        if (m_trackers[0]->independentFrames()) {
+            std::vector<cv::Point2f>& selected_track = m_track_cache[trackKey(0, m_frame_set)];
+            selected_track.clear();
+            for (int i : m_selected_frames) selected_track.push_back(tracks[0][i]);
+        }
+        std::cout << "Selected " << m_selected_frames.size() << " of " << num_frames << " frames by viewpoint." << std::endl;
+        setStatus("Processing... Calculating shifts for all templates.");
+    }
+
+    m_active_frames_gray.clear();
+    m_active_frames_color.clear();
+    for (int i : m_selected_frames) {
+        m_active_frames_gray.push_back(m_frames.gray(i));
+        m_active_frames_color.push_back(m_frames.color(i));
+    }
+}
+
+void SyntheticAperture::trackTemplates(const std::vector<cv::Mat>& frames_gray, const std::string& frame_set,
+                                       const std::vector<size_t>& templates, std::vector<std::vector<cv::Point2f>>& tracks,
+                                       std::vector<float>* pair_ms) {
+    const size_t num_templates = m_params.template_points.size();
+    const size_t num_frames = frames_gray.size();
+
+    tracks.assign(num_templates, std::vector<cv::Point2f>(num_frames, cv::Point2f(0, 0)));
+    std::vector<std::string> keys(num_templates);
+    m_tracked_templates.clear();
+    for (size_t t : templates) {
+        keys[t] = trackKey(t, frame_set);
+        auto cached = m_track_cache.find(keys[t]);
+        if (cached != m_track_cache.end()) {
+            tracks[t] = cached->second;
+        } else {
+            m_tracked_templates.push_back(t);
+        }
+    }
+    prepareTemplates();
+
+    const size_t num_tracked = m_tracked_templates.size();
+    const bool sparse_motion = m_params.tracker == SA_TrackerType::SparseMotion && num_tracked > 0 && buildMotionField() &&
+                               m_motion_field.isValid();
+    if (m_cancel_requested) return;
+    std::cout << "Reusing " << (templates.size() - num_tracked) << " memoized tracks, tracking " << num_tracked << " templates over "
+              << num_frames << " frames." << std::endl;
+    setStage("Tracking", (int)(num_tracked * num_frames));
+    // Frame-major [frame * num_templates + template]; every job writes only its own slot.
+    std::vector<float> frame_ms(num_templates * num_frames, 0.0f);
+
+    if (sparse_motion) {
+        // A template reduces to a single parallax; its track follows from the shared motion.
+        // frames_gray is always the active frame set here, so m_selected_frames maps it to
+        // the loaded frames the field was built over.
+        const std::vector<cv::Mat>& all_frames = m_frames.grayFrames();
+        cv::parallel_for_(cv::Range(0, (int)num_tracked), [&](const cv::Range& range) {
+            for (int j = range.start; j < range.end && !m_cancel_requested; ++j) {
+                size_t t = m_tracked_templates[j];
+                SA_Clock::time_point t0 = SA_Clock::now();
+                float parallax = m_motion_field.templateParallax(all_frames, m_template_pyramids[t][0], m_params.template_points[t]);
+                for (size_t i = 0; i < num_frames; ++i) tracks[t][i] = m_motion_field.shiftAt(parallax, m_selected_frames[i]);
+                float ms = (float)(elapsedMs(t0) / std::max<size_t>(1, num_frames - 1));
+                for (size_t i = 1; i < num_frames; ++i) frame_ms[i * num_templates + t] = ms;
+                for (size_t i = 0; i < num_frames; ++i) advanceProgress();
+            }
+        });
+    } else if (useFFTCorrelator() && num_tracked > 0) {
+        // The FFT engine shares one forward transform between all templates of a frame, so
+        // frames are the unit of work here.
+        cv::parallel_for_(cv::Range(1, (int)num_frames), [&](const cv::Range& range) {
+            std::vector<cv::Point2f> frame_shifts;
+            std::vector<float> latencies_ms;
+            for (int i = range.start; i < range.end && !m_cancel_requested; ++i) {
+                matchAllTemplatesInFrame(frames_gray[i], {}, frame_shifts, &latencies_ms);
+                for (size_t j = 0; j < num_tracked; ++j) {
+                    size_t t = m_tracked_templates[j];
+                    tracks[t][i] = frame_shifts[j];
+                    frame_ms[i * num_templates + t] = latencies_ms[j];
+                    advanceProgress();
+                }
+            }
+        });
+    } else if (m_trackers[0]->independentFrames()) {
+        // Every (template, frame) pair is independent: the search window is anchored at the
+        // template's frame-0 origin. Each pair writes only its own preallocated slot, so the
+        // result does not depend on scheduling.
+        cv::parallel_for_(cv::Range(0, (int)(num_tracked * num_frames)), [&](const cv::Range& range) {
+            for (int job = range.start; job < range.end && !m_cancel_requested; ++job) {
+                size_t t = m_tracked_templates[job / num_frames];
+                size_t i = job % num_frames;
+                if (i > 0) {
+                    SA_Clock::time_point t0 = SA_Clock::now();
+                    tracks[t][i] = m_trackers[t]->track(frames_gray[i], kNoHistory);
+                    frame_ms[i * num_templates + t] = (float)elapsedMs(t0);
+                }
+                advanceProgress();
+            }
+        });
+    } else {
+        // Each frame is seeded with the frames before, so a template's frames run in order and
+        // only the templates run in parallel.
+        cv::parallel_for_(cv::Range(0, (int)num_tracked), [&](const cv::Range& range) {
+            std::vector<cv::Point2f> history;
+            for (int j = range.start; j < range.end; ++j) {
+                size_t t = m_tracked_templates[j];
+                history.assign(1, tracks[t][0]);
+                advanceProgress();
+                for (size_t i = 1; i < num_frames && !m_cancel_requested; ++i) {
+                    SA_Clock::time_point t0 = SA_Clock::now();
+                    tracks[t][i] = m_trackers[t]->track(frames_gray[i], history);
+                    history.push_back(tracks[t][i]);
+                    frame_ms[i * num_templates + t] = (float)elapsedMs(t0);
+                    advanceProgress();
+                }
+            }
+        });
+    }
+    if (m_cancel_requested) return;
+
+    for (size_t t : m_tracked_templates) m_track_cache[keys[t]] = tracks[t];
+    if (pair_ms) pair_ms->swap(frame_ms);
+}
+
+// A track depends on the template's origin and size, how it is searched and the frame set.
+// frame_set is empty for all loaded frames; loadVideo() changes those and clears the cache.
+std::string SyntheticAperture::trackKey(size_t template_index, const std::string& frame_set) const {
+    const cv::Point& origin = m_params.template_points[template_index];
+    return std::to_string(origin.x) + "," + std::to_string(origin.y) +
+           "|size=" + std::to_string(m_params.template_size) +
+           "|window=" + std::to_string(m_params.search_window_size) +
+           "|predictive=" + std::to_string((int)m_params.predictive_search) +
+           "|tracker=" + std::to_string((int)m_params.tracker) +
+           "|method=" + std::to_string((int)m_params.correlation_method) +
+           "|levels=" + std::to_string(m_params.pyramid_levels) +
+           "|subpixel=" + std::to_string((int)m_params.subpixel_refinement) +
+           (frame_set.empty() ? std::string() : "|frames=" + frame_set);
+}
+
+std::string SyntheticAperture::depthInputsKey() const {
+    std::string key = "planes=" + std::to_string(m_params.depth_planes);
+    for (size_t t = 0; t < m_params.template_points.size(); ++t) key += "#" + trackKey(t, m_frame_set);
+    return key;
+}
+
+std::string SyntheticAperture::synthesisInputsKey() const {
+    if (m_params.template_points.empty()) return std::string();
+    return "fixed_point=" + std::to_string((int)m_params.fixed_point_accumulation) +
+           "|render_scale=" + std::to_string(renderScaleFactor()) + "#" + trackKey(0, m_frame_set);
+}
+
+bool SyntheticAperture::buildMotionField() {
+    if (m_motion_field_built) return true;
+    std::cout << "--- Sparse Motion Field ---" << std::endl;
+    const std::vector<cv::Mat>& frames_gray = m_frames.grayFrames();
+    setStatus("Processing... Estimating camera motion.");
+    setStage("Motion field", (int)frames_gray.size());
+    double stage_start = processClockMs();
+
+    m_motion_field.begin(frames_gray[0]);
+    advanceProgress();
+    for (size_t i = 1; i < frames_gray.size(); ++i) {
+        if (m_cancel_requested) {
+            m_motion_field.clear();
+            return false;
+        }
+        m_motion_field.addFrame(frames_gray[i]);
+        advanceProgress();
+    }
+    if (m_motion_field.fit()) {
+        std::cout << "Fitted camera motion to " << m_motion_field.featureCount() << " corners over " << frames_gray.size() << " frames.\n" << std::endl;
+    } else {
+        std::cerr << "Warning: Too few corners could be tracked; falling back to per-frame template tracking." << std::endl;
+    }
+    m_motion_field_built = true;
+    addStage("Motion field", stage_start, processClockMs() - stage_start);
+    setStatus("Processing... Calculating shifts for all templates.");
+    return true;
+}
+
+void SyntheticAperture::resetMemoizedResults() {
+    m_track_cache.clear();
+    m_motion_field.clear();
+    m_motion_field_built = false;
+    m_depth_inputs.clear();
+    m_synthesis_inputs.clear();
+}
+
+void SyntheticAperture::prepareTemplates() {
+    m_template_pyramids.clear();
     for (const auto& template_origin : m_params.template_points) {
         cv::Rect template_roi(template_origin.x, template_origin.y, m_params.template_size, m_params.template_size);
-        m_template_image = m_frames_gray[0](template_roi);
+        int levels = useFFTCorrelator() ? 0 : m_params.pyramid_levels;
+        m_template_pyramids.push_back(buildTemplatePyramid(m_first_gray_frame(template_roi).clone(), levels));
+    }
+    m_template_image = m_template_pyramids.back()[0];
 
-        cv::Point search_offset(template_origin.x - search_margin, template_origin.y - search_margin);
-        std::vector<cv::Point2f> current_template_shifts;
+    m_trackers.clear();
+    for (size_t t = 0; t < m_template_pyramids.size(); ++t) {
+        const cv::Point& origin = m_params.template_points[t];
+        if (m_params.tracker != SA_TrackerType::NCC) {
+            m_trackers.push_back(std::make_unique<InverseCompositionalTracker>(m_template_pyramids[t], origin, m_params.search_window_size,
+                                                                               m_params.subpixel_refinement));
+        } else {
+            m_trackers.push_back(std::make_unique<NCCTracker>(m_template_pyramids[t], origin, m_params.search_window_size,
+                                                              m_params.subpixel_refinement, m_params.predictive_search));
+        }
+    }
 
-        for (size_t i = 0; i < m_frames_gray.size(); ++i) {
-            if (i == 0) {
-                current_template_shifts.emplace_back(0, 0);
-                continue;
-            }
+    m_fft_correlator = FFTCorrelator();
+    if (useFFTCorrelator() && !m_tracked_templates.empty()) {
+        std::vector<cv::Mat> templates;
+        std::vector<cv::Rect> search_rois;
+        for (size_t t : m_tracked_templates) {
+            templates.push_back(m_template_pyramids[t][0]);
+            search_rois.push_back(searchWindowRect(t, m_first_gray_frame.size()));
+        }
+        m_fft_correlator.prepare(templates, search_rois);
+    }
+}
+
+cv::Rect SyntheticAperture::searchWindowRect(size_t template_index, const cv::Size& frame_size) const {
+    return searchWindowAround(m_params.template_points[template_index], m_params.template_size, m_params.search_window_size, frame_size);
+}
+
+bool SyntheticAperture::useFFTCorrelator() const {
+    return m_params.tracker == SA_TrackerType::NCC && m_params.correlation_method == SA_CorrelationMethod::FFT && !m_params.predictive_search;
+}
 
-            cv::Rect search_window_roi(search_offset.x, search_offset.y, m_params.search_window_size, m_params.search_window_size);
-            search_window_roi &= cv::Rect(0, 0, m_frames_gray[i].cols, m_frames_gray[i].rows);
+void SyntheticAperture::matchAllTemplatesInFrame(const cv::Mat& frame_gray, const std::vector<std::vector<cv::Point2f>>& histories,
+                                                 std::vector<cv::Point2f>& shifts, std::vector<float>* latencies_ms) const {
+    const size_t num_templates = m_tracked_templates.size();
+    if (latencies_ms) latencies_ms->assign(num_templates, 0.0f);
 
-            cv::Mat search_window = m_frames_gray[i](search_window_roi);
-            cv::Mat correlation_map;
-            cv::matchTemplate(search_window, m_template_image, correlation_map, cv::TM_CCOEFF_NORMED);
+    if (!m_fft_correlator.empty()) {
+        SA_Clock::time_point t0 = SA_Clock::now();
+        m_fft_correlator.match(frame_gray, shifts, m_params.subpixel_refinement);
+        for (size_t j = 0; j < shifts.size(); ++j) {
+            const cv::Point& origin = m_params.template_points[m_tracked_templates[j]];
+            shifts[j] -= cv::Point2f(origin.x, origin.y);
+        }
+        // The forward transform is shared, so the frame's cost is split evenly across templates.
+        if (latencies_ms) latencies_ms->assign(num_templates, (float)(elapsedMs(t0) / num_templates));
+        return;
+    }
+    shifts.resize(num_templates);
+    cv::parallel_for_(cv::Range(0, (int)num_templates), [&](const cv::Range& range) {
+        for (int j = range.start; j < range.end; ++j) {
+            size_t t = m_tracked_templates[j];
+            SA_Clock::time_point t0 = SA_Clock::now();
+            shifts[j] = m_trackers[t]->track(frame_gray, histories.empty() ? kNoHistory : histories[t]);
+            if (latencies_ms) (*latencies_ms)[j] = (float)elapsedMs(t0);
+        }
+    });
+}
 
-            cv::Point peak_loc;
-            cv::minMaxLoc(correlation_map, nullptr, nullptr, nullptr, &peak_loc);
+// Single pass over the video: every decoded frame is tracked against all templates and,
+// since synthesis only needs template 0's shift for that frame, accumulated right away.
+// Nothing but frame 0, the template patches and the accumulator outlives an iteration. A
+// separate render resolution needs the whole track first, so synthesis is a second pass.
+bool SyntheticAperture::processStreaming() {
+    std::cout << "--- Streaming: Tracking and Accumulating Frames ---" << std::endl;
+    setStatus("Processing... Streaming frames.");
+    m_multi_template_shifts.assign(m_params.template_points.size(), std::vector<cv::Point2f>());
+    m_tracked_templates.clear();
+    for (size_t t = 0; t < m_params.template_points.size(); ++t) m_tracked_templates.push_back(t);
+    prepareTemplates();
 
-            float sx = (search_window_roi.x + peak_loc.x) - template_origin.x;
-            float sy = (search_window_roi.y + peak_loc.y) - template_origin.y;
+    FrameSource source = selectedFrames(m_load_params.max_frames);
+    if (!source.open(m_video_path)) {
+        setStatus("FATAL ERROR: Video file not found at '" + m_video_path + "'");
+        std::cerr << getStatusMessage() << std::endl;
+        return false;
+    }
 
-            current_template_shifts.emplace_back(sx, sy);
+    const bool accumulate = !rendersFromVideo();
+    cv::Mat accumulator;
+    if (accumulate) accumulator = createShiftAccumulator(m_first_color_frame.size(), m_params.fixed_point_accumulation);
+    cv::Mat frame, color, gray;
+    std::vector<cv::Point2f> frame_shifts;
+    std::vector<float> latencies_ms, pair_ms;
+    double stream_start = processClockMs();
+    double decode_ms = 0.0, preprocess_ms = 0.0, tracking_ms = 0.0, accumulate_ms = 0.0;
+    setStage("Streaming", source.expectedFrames());
+    int frame_count = 0;
+    SA_Clock::time_point t0 = SA_Clock::now();
+    while (source.read(frame)) {
+        decode_ms += elapsedMs(t0);
+        if (checkCancelled()) return false;
+
+        t0 = SA_Clock::now();
+        preprocessFrame(frame, color, gray);
+        preprocess_ms += elapsedMs(t0);
+
+        t0 = SA_Clock::now();
+        if (frame_count == 0) {
+            frame_shifts.assign(m_multi_template_shifts.size(), cv::Point2f(0, 0));
+            latencies_ms.assign(m_multi_template_shifts.size(), 0.0f);
+        } else {
+            matchAllTemplatesInFrame(gray, m_multi_template_shifts, frame_shifts, &latencies_ms);
         }
-        m_multi_template_shifts.push_back(current_template_shifts);
+        for (size_t t = 0; t < frame_shifts.size(); ++t) m_multi_template_shifts[t].push_back(frame_shifts[t]);
+        pair_ms.insert(pair_ms.end(), latencies_ms.begin(), latencies_ms.end());
+        tracking_ms += elapsedMs(t0);
+
+        if (accumulate) {
+            t0 = SA_Clock::now();
+            accumulateShiftedFrame(color, m_multi_template_shifts[0].back(), accumulator);
+            accumulate_ms += elapsedMs(t0);
+        }
+
+        frame_count++;
+        advanceProgress();
+        t0 = SA_Clock::now();
     }
-    std::cout << "Finished calculating all pixel shifts for " << m_multi_template_shifts.size() << " templates.\n" << std::endl;
+    source.release();
+
+    addStage("Decode", stream_start, decode_ms);
+    addStage("Resize/rotate", stream_start + decode_ms, preprocess_ms);
+    addStage("Tracking", stream_start + decode_ms + preprocess_ms, tracking_ms);
+    if (accumulate) addStage("Synthesis", stream_start + decode_ms + preprocess_ms + tracking_ms, accumulate_ms);
+    recordMatchLatencies(pair_ms, m_multi_template_shifts.size(), m_multi_template_shifts.size());
+    m_metrics.frames_processed = frame_count;
+
+    if (frame_count == 0) {
+        setStatus("Error: No frames were decoded from the video.");
+        std::cerr << getStatusMessage() << std::endl;
+        return false;
+    }
+    std::cout << "Streamed " << frame_count << " frames.\n" << std::endl;
+    m_selected_frames.resize(frame_count);
+    std::iota(m_selected_frames.begin(), m_selected_frames.end(), 0);
+    m_parallax_model.fit(m_multi_template_shifts);
+    m_focal_parallax = 0.0f;
+
+    setStatus("Processing... Creating depth map.");
+    setStage("Depth map", 0);
+    double stage_start = processClockMs();
+    if (!createDepthMap() || checkCancelled()) return false;
+    addStage("Depth map", stage_start, processClockMs() - stage_start);
+
+    if (accumulate) {
+        finishShiftedMean(accumulator, frame_count, m_synthetic_image);
+        return true;
+    }
+    setStatus("Processing... Creating synthetic image (using first template).");
+    stage_start = processClockMs();
+    if (!renderFromVideo(m_multi_template_shifts[0])) return false;
+    addStage("Synthesis", stage_start, processClockMs() - stage_start);
+    return true;
 }
 
-void SyntheticAperture::createDepthMap() {
+// False, with the status set, if the dense sweep could not read its frames.
+bool SyntheticAperture::createDepthMap() {
     std::cout << "--- Step 4: Creating Depth Map ---" << std::endl;
     m_parallaxes.clear();
     m_depth_map = cv::Mat::zeros(m_first_color_frame.size(), CV_8UC3);
+    m_depth_index = cv::Mat();
+    m_depth_confidence = cv::Mat();
 
     if (m_multi_template_shifts.size() < 2) {
-        m_status_message = "Depth map requires at least 2 templates.";
-        std::cout << m_status_message << std::endl;
+        setStatus("Depth map requires at least 2 templates.");
+        std::cout << getStatusMessage() << std::endl;
         m_depth_map = m_first_color_frame.clone();
-        cv::putText(m_depth_map, m_status_message, cv::Point(10,30), cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0,0,255), 2);
-        return;
+        cv::putText(m_depth_map, getStatusMessage(), cv::Point(10,30), cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0,0,255), 2);
+        return true;
     }
 
+    if (m_params.depth_planes > 0 && m_parallax_model.isValid()) {
+        if (!createDenseDepthMap()) return false;
+        std::cout << "Dense depth map created successfully.\n" << std::endl;
+        return true;
+    }
 
     float min_parallax = std::numeric_limits<float>::max();
     float max_parallax = std::numeric_limits<float>::min();
@@ -186,45 +839,407 @@ void SyntheticAperture::createDepthMap() {
     }
 
     std::cout << "Depth map created successfully.\n" << std::endl;
+    return true;
+}
+
+bool SyntheticAperture::createDenseDepthMap() {
+    const int num_planes = std::min(m_params.depth_planes, 256);
+    const size_t num_frames = m_parallax_model.frameCount();
+
+    // Sweep slightly beyond the tracked templates so scene parts in front of the nearest and
+    // behind the farthest template still find a plane.
+    float lo = m_parallax_model.minParallax();
+    float hi = m_parallax_model.maxParallax();
+    float margin = 0.1f * (hi - lo);
+    lo -= margin;
+    hi += margin;
+
+    std::vector<float> plane_parallaxes(num_planes);
+    std::vector<std::vector<cv::Point2f>> plane_shifts(num_planes);
+    for (int k = 0; k < num_planes; ++k) {
+        plane_parallaxes[k] = num_planes > 1 ? lo + (hi - lo) * k / (num_planes - 1) : 0.5f * (lo + hi);
+        plane_shifts[k] = m_parallax_model.trackAt(plane_parallaxes[k]);
+    }
+
+    PlaneSweepDepth sweep(m_first_gray_frame.size(), num_planes);
+    if (m_load_params.streaming) {
+        // More decoding passes: the planes are only known once every template is tracked, and
+        // each pass keeps only as many planes resident as the sweep's memory budget allows.
+        cv::Mat frame, color, gray;
+        std::vector<cv::Point2f> frame_plane_shifts(num_planes);
+        const int num_passes = sweep.passCount();
+        for (int pass = 0; pass < num_passes && !m_cancel_requested; ++pass) {
+            FrameSource source = selectedFrames((int)num_frames);
+            if (!source.open(m_video_path)) {
+                setStatus("FATAL ERROR: Video file not found at '" + m_video_path + "'");
+                std::cerr << getStatusMessage() << std::endl;
+                return false;
+            }
+            setStage("Depth map (pass " + std::to_string(pass + 1) + "/" + std::to_string(num_passes) + ")", (int)num_frames);
+            size_t frames_read = 0;
+            for (; frames_read < num_frames && !m_cancel_requested && source.read(frame); ++frames_read) {
+                preprocessFrame(frame, color, gray);
+                for (int k = 0; k < num_planes; ++k) frame_plane_shifts[k] = plane_shifts[k][frames_read];
+                sweep.accumulate(gray, frame_plane_shifts);
+                advanceProgress();
+            }
+            if (frames_read == 0 && !m_cancel_requested) {
+                setStatus("Error: No frames were decoded from the video.");
+                std::cerr << getStatusMessage() << std::endl;
+                return false;
+            }
+            sweep.finishPass();
+        }
+        sweep.resolve();
+    } else {
+        sweep.sweep(m_active_frames_gray, plane_shifts);
+    }
+    m_depth_index = sweep.depthIndex();
+    m_depth_confidence = sweep.confidence();
+
+    // Same coloring as the per-template markers: blue (far, min parallax) to red (near, max parallax).
+    std::vector<float> plane_magnitudes(num_planes);
+    for (int k = 0; k < num_planes; ++k) plane_magnitudes[k] = cv::norm(plane_shifts[k].back());
+    float min_magnitude = *std::min_element(plane_magnitudes.begin(), plane_magnitudes.end());
+    float max_magnitude = *std::max_element(plane_magnitudes.begin(), plane_magnitudes.end());
+    float magnitude_range = max_magnitude - min_magnitude;
+
+    std::vector<cv::Vec3b> palette(num_planes);
+    for (int k = 0; k < num_planes; ++k) {
+        float normalized_p = magnitude_range > 1e-5 ? (plane_magnitudes[k] - min_magnitude) / magnitude_range : 0.0f;
+        palette[k] = cv::Vec3b(cv::saturate_cast<uchar>(255 * (1.0 - normalized_p)), 0, cv::saturate_cast<uchar>(255 * normalized_p));
+    }
+    for (int y = 0; y < m_depth_index.rows; ++y) {
+        const uchar* index = m_depth_index.ptr<uchar>(y);
+        cv::Vec3b* out = m_depth_map.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < m_depth_index.cols; ++x) out[x] = palette[index[x]];
+    }
+    return true;
 }
 
-void SyntheticAperture::createSyntheticImage() {
+// False, with the status set, if no image could be rendered.
+bool SyntheticAperture::createSyntheticImage() {
     std::cout << "--- Step 5: Creating Synthetic Aperture Photograph ---" << std::endl;
+    m_synthetic_image = cv::Mat();
     if (m_multi_template_shifts.empty()) {
-        m_synthetic_image = cv::Mat();
-        return;
+        setStatus("Error: No template shifts to render.");
+        std::cerr << getStatusMessage() << std::endl;
+        return false;
     }
 
-    const auto& shifts = m_multi_template_shifts[0];
+    if (!renderSyntheticImage(m_multi_template_shifts[0])) return false;
+    std::cout << "Synthetic aperture photograph created successfully.\n" << std::endl;
+    return true;
+}
+
+bool SyntheticAperture::renderSyntheticImage(const std::vector<cv::Point2f>& shifts) {
+    if (rendersFromVideo()) return renderFromVideo(shifts);
+    renderShiftedMean(m_active_frames_color, shifts, m_frame_weights, m_params.fixed_point_accumulation, m_synthetic_image);
+    return true;
+}
+
+// Renders the active frames at the render scale when it differs from the tracking scale, e.g.
+// at full resolution from tracks measured on small frames. The clip is decoded again and each
+// color frame resampled straight to the render scale. shifts are per active frame in tracking
+// pixels; a render pixel is scale_factor / render_scale_factor of them. The frames are decoded
+// once into a render cache and every render, refocusing included, tiles over the mapping. Only
+// if the cache cannot be written is the clip decoded again, once per band of output rows, so
+// the accumulator stays within kRenderBandBytes whatever the render size.
+bool SyntheticAperture::renderFromVideo(const std::vector<cv::Point2f>& shifts) {
+    const int render_scale = renderScaleFactor();
+    const float shift_scale = (float)m_load_params.scale_factor / render_scale;
+    std::cout << "Rendering at 1/" << render_scale << " scale from the video (tracked at 1/" << m_load_params.scale_factor << ")." << std::endl;
+
+    const std::string cache_key = renderCacheKey();
+    if (!cache_key.empty() && (cache_key == m_render_cache_key || buildRenderCache(cache_key))) {
+        std::vector<cv::Point2f> render_shifts;
+        for (const auto& shift : shifts) render_shifts.push_back(shift * shift_scale);
+        renderShiftedMean(m_render_cache.framesColor(), render_shifts, m_frame_weights, m_params.fixed_point_accumulation, m_synthetic_image);
+        return true;
+    }
+    if (checkCancelled()) return false;
+
+    cv::Mat frame, color, accumulator;
+    int band_rows = 0;
+    for (int first_row = 0, pass = 1; band_rows == 0 || first_row < m_synthetic_image.rows; first_row += band_rows, ++pass) {
+        FrameSource source = selectedFrames(m_load_params.max_frames);
+        if (!source.open(m_video_path)) {
+            setStatus("FATAL ERROR: Video file not found at '" + m_video_path + "'");
+            std::cerr << getStatusMessage() << std::endl;
+            return false;
+        }
+        setStage("Rendering (pass " + std::to_string(pass) + ")", (int)m_selected_frames.size());
+        int total_weight = 0;
+        size_t next = 0;
+        for (int i = 0; next < m_selected_frames.size() && next < shifts.size() && source.read(frame); ++i) {
+            if (checkCancelled()) return false;
+            if (i != m_selected_frames[next]) continue;
+            resampleFrame(frame, color, render_scale);
+            if (band_rows == 0) {
+                // The first frame fixes the render size and with it the band height.
+                band_rows = (int)std::max<size_t>(1, kRenderBandBytes / ((size_t)color.cols * 3 * sizeof(float)));
+                m_synthetic_image.create(color.size(), CV_8UC3);
+            }
+            if (accumulator.empty()) {
+                accumulator = createShiftAccumulator(cv::Size(color.cols, std::min(band_rows, color.rows - first_row)),
+                                                     m_params.fixed_point_accumulation);
+            }
+            int weight = m_frame_weights.empty() ? 1 : m_frame_weights[next];
+            accumulateShiftedFrameRows(color, shifts[next] * shift_scale, weight, accumulator, first_row);
+            total_weight += weight;
+            next++;
+            advanceProgress();
+        }
+        source.release();
 
-    cv::Mat synthetic_image_float = cv::Mat::zeros(m_frames_color[0].size(), CV_32FC3);
+        if (total_weight == 0) {
+            m_synthetic_image = cv::Mat();
+            setStatus("Error: No frames were decoded from the video.");
+            std::cerr << getStatusMessage() << std::endl;
+            return false;
+        }
+        cv::Mat band = m_synthetic_image.rowRange(first_row, first_row + accumulator.rows);
+        finishShiftedMean(accumulator, total_weight, band);
+        accumulator.release();
+    }
+    return true;
+}
 
-    for (size_t i = 0; i < m_frames_color.size(); ++i) {
-        const auto& color_frame = m_frames_color[i];
-        float sx = shifts[i].x;
-        float sy = shifts[i].y;
+std::string SyntheticAperture::renderCacheKey() const {
+    std::string key = frameCacheKey(m_video_path, m_load_params);
+    if (key.empty()) return key;
+    key += "|render_scale=" + std::to_string(renderScaleFactor()) + "|selected=";
+    for (int i : m_selected_frames) key += std::to_string(i) + ",";
+    return key;
+}
 
-        cv::Mat translation_matrix = (cv::Mat_<double>(2, 3) << 1, 0, -sx, 0, 1, -sy);
+// The file is named after the loaded clip alone, so a new selection or render scale replaces
+// the clip's previous render cache instead of adding another full-resolution stack beside it.
+// Without a frame cache directory it is a file of this processor's own in the temp directory,
+// deleted by releaseRenderCache().
+std::string SyntheticAperture::renderCachePath() const {
+    const std::string clip = frameCacheKey(m_video_path, m_load_params) + "|render";
+    if (!m_load_params.frame_cache_dir.empty()) return frameCachePath(m_load_params.frame_cache_dir, clip);
+    std::error_code ec;
+    std::filesystem::path temp = std::filesystem::temp_directory_path(ec);
+    if (ec) return std::string();
+    return frameCachePath((temp / "synthetic_aperture_render").string(), clip + "|owner=" + m_render_cache_owner);
+}
 
-        cv::Mat shifted_frame;
-        cv::warpAffine(color_frame, shifted_frame, translation_matrix, color_frame.size(), cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(0,0,0));
+void SyntheticAperture::releaseRenderCache() {
+    m_render_cache.close();
+    m_render_cache_key.clear();
+    if (!m_render_cache_temp_path.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(m_render_cache_temp_path, ec);
+        m_render_cache_temp_path.clear();
+    }
+}
 
-        cv::Mat shifted_float;
-        shifted_frame.convertTo(shifted_float, CV_32FC3);
+// Maps the render cache for key, first decoding the active frames into it one at a time if no
+// earlier run left one. False if cancelled, or if the cache cannot be written or mapped.
+bool SyntheticAperture::buildRenderCache(const std::string& key) {
+    releaseRenderCache();
+    const std::string cache_path = renderCachePath();
+    if (cache_path.empty()) return false;
+    if (m_load_params.frame_cache_dir.empty()) m_render_cache_temp_path = cache_path;
+    if (m_render_cache.open(cache_path, key)) {
+        m_render_cache_key = key;
+        return true;
+    }
 
-        synthetic_image_float += shifted_float;
+    FrameSource source = selectedFrames(m_load_params.max_frames);
+    if (!source.open(m_video_path)) return false;
+    setStage("Render cache", (int)m_selected_frames.size());
+    FrameCacheWriter writer;
+    cv::Mat frame, color;
+    size_t next = 0;
+    for (int i = 0; next < m_selected_frames.size() && source.read(frame); ++i) {
+        if (m_cancel_requested) return false;
+        if (i != m_selected_frames[next]) continue;
+        resampleFrame(frame, color, renderScaleFactor());
+        if (next == 0 && !writer.open(cache_path, key, (int)m_selected_frames.size(), color, cv::Mat())) break;
+        if (!writer.write(color)) break;
+        next++;
+        advanceProgress();
     }
+    source.release();
 
-    synthetic_image_float /= (float)m_frames_color.size();
-    synthetic_image_float.convertTo(m_synthetic_image, CV_8UC3);
-    std::cout << "Synthetic aperture photograph created successfully.\n" << std::endl;
+    if (!writer.finish() || !m_render_cache.open(cache_path, key)) {
+        std::cerr << "Warning: Could not write render cache '" << cache_path << "'; decoding the video for this render." << std::endl;
+        return false;
+    }
+    std::cout << "Wrote render cache '" << cache_path << "'" << std::endl;
+    m_render_cache_key = key;
+    return true;
 }
 
+int SyntheticAperture::renderScaleFactor() const {
+    return m_params.render_scale_factor > 0 ? m_params.render_scale_factor : m_load_params.scale_factor;
+}
+
+bool SyntheticAperture::rendersFromVideo() const {
+    return renderScaleFactor() != m_load_params.scale_factor;
+}
+
+bool SyntheticAperture::canRefocus() const {
+    return m_is_processed && m_parallax_model.isValid() && (!m_active_frames_color.empty() || rendersFromVideo());
+}
+
+bool SyntheticAperture::refocus(float parallax) {
+    if (!canRefocus()) {
+        setStatus(m_load_params.streaming ? "Refocusing needs the decoded frames. Reload without streaming mode."
+                                                   : "Cannot refocus. Process the video first.");
+        return false;
+    }
+    m_cancel_requested = false;
+    m_focal_parallax = parallax;
+    m_synthesis_inputs.clear();
+    bool ok = renderSyntheticImage(m_parallax_model.trackAt(parallax));
+    publishSnapshot();
+    return ok;
+}
+
+bool SyntheticAperture::refocusOnTemplate(size_t template_index) {
+    if (!canRefocus() || template_index >= m_multi_template_shifts.size()) {
+        setStatus("Cannot refocus on that template.");
+        return false;
+    }
+    // A tracked template renders with its own measured track rather than the model's fit.
+    m_cancel_requested = false;
+    m_focal_parallax = m_parallax_model.templateParallax(template_index);
+    m_synthesis_inputs.clear();
+    bool ok = renderSyntheticImage(m_multi_template_shifts[template_index]);
+    publishSnapshot();
+    return ok;
+}
+
+float SyntheticAperture::getFocalParallax() const { return m_focal_parallax; }
+float SyntheticAperture::getMinParallax() const { return m_parallax_model.minParallax(); }
+float SyntheticAperture::getMaxParallax() const { return m_parallax_model.maxParallax(); }
+float SyntheticAperture::getTemplateParallax(size_t template_index) const { return m_parallax_model.templateParallax(template_index); }
+
+
+const std::vector<int>& SyntheticAperture::getSelectedFrames() const { return m_selected_frames; }
+const std::vector<int>& SyntheticAperture::getFrameWeights() const { return m_frame_weights; }
 
 const cv::Mat& SyntheticAperture::getFirstColorFrame() const { return m_first_color_frame; }
 const cv::Mat& SyntheticAperture::getTemplateImage() const { return m_template_image; }
 const cv::Mat& SyntheticAperture::getSyntheticImage() const { return m_synthetic_image; }
-const std::string& SyntheticAperture::getStatusMessage() const { return m_status_message; }
+
+std::string SyntheticAperture::getStatusMessage() const {
+    std::lock_guard<std::mutex> lock(m_status_mutex);
+    return m_status_message;
+}
+
+void SyntheticAperture::setStatus(const std::string& message) {
+    std::lock_guard<std::mutex> lock(m_status_mutex);
+    m_status_message = message;
+}
+
+SA_Progress SyntheticAperture::getProgress() const {
+    SA_Progress progress;
+    {
+        std::lock_guard<std::mutex> lock(m_status_mutex);
+        progress.stage = m_stage;
+    }
+    progress.done = m_progress_done;
+    progress.total = m_progress_total;
+    return progress;
+}
+
+void SyntheticAperture::setStage(const std::string& stage, int total) {
+    std::lock_guard<std::mutex> lock(m_status_mutex);
+    m_stage = stage;
+    m_progress_done = 0;
+    m_progress_total = total;
+}
+
+void SyntheticAperture::advanceProgress() {
+    m_progress_done++;
+}
+
+void SyntheticAperture::requestCancel() {
+    m_cancel_requested = true;
+}
+
+bool SyntheticAperture::checkCancelled() {
+    if (!m_cancel_requested) return false;
+    setStatus("Cancelled.");
+    std::cout << "Cancelled.\n" << std::endl;
+    return true;
+}
+
+const SA_Metrics& SyntheticAperture::getMetrics() const {
+    return m_metrics;
+}
+
+void SyntheticAperture::beginProcessMetrics() {
+    m_metrics.stages.resize(m_metrics.load_stage_count);
+    m_metrics.template_tracking_ms.clear();
+    m_metrics.match_latency_ms.clear();
+    m_metrics.resident_frame_bytes = frameStoreBytes();
+    m_process_start = SA_Clock::now();
+}
+
+double SyntheticAperture::processClockMs() const {
+    return m_metrics.load_ms + elapsedMs(m_process_start);
+}
+
+void SyntheticAperture::addStage(const std::string& name, double start_ms, double duration_ms) {
+    m_metrics.stages.push_back({ name, start_ms, duration_ms });
+}
+
+// Templates reused from the track cache have zero entries and are left out of the per-frame mean.
+void SyntheticAperture::recordMatchLatencies(const std::vector<float>& pair_ms, size_t num_templates, size_t num_matched) {
+    if (num_templates == 0 || num_matched == 0) return;
+    size_t num_frames = pair_ms.size() / num_templates;
+    m_metrics.template_tracking_ms.assign(num_templates, 0.0);
+    m_metrics.match_latency_ms.assign(num_frames, 0.0f);
+    for (size_t i = 0; i < num_frames; ++i) {
+        for (size_t t = 0; t < num_templates; ++t) {
+            float ms = pair_ms[i * num_templates + t];
+            m_metrics.template_tracking_ms[t] += ms;
+            m_metrics.match_latency_ms[i] += ms / num_matched;
+        }
+    }
+}
+
+size_t SyntheticAperture::frameStoreBytes() const {
+    size_t bytes = m_first_color_frame.total() * m_first_color_frame.elemSize() +
+                   m_first_gray_frame.total() * m_first_gray_frame.elemSize();
+    bytes += m_frames.bytes();
+    return bytes;
+}
+
+std::shared_ptr<const SA_Snapshot> SyntheticAperture::getSnapshot() const {
+    return std::atomic_load(&m_snapshot);
+}
+
+// Mats are cloned so later runs writing into reused member buffers never touch a published snapshot.
+void SyntheticAperture::publishSnapshot() {
+    auto snapshot = std::make_shared<SA_Snapshot>();
+    snapshot->video_loaded = m_video_loaded;
+    snapshot->processed = m_is_processed;
+    snapshot->can_refocus = canRefocus();
+    snapshot->first_color_frame = m_first_color_frame.clone();
+    snapshot->metrics = m_metrics;
+    if (m_is_processed) {
+        snapshot->template_image = m_template_image.clone();
+        snapshot->synthetic_image = m_synthetic_image.clone();
+        snapshot->depth_map = m_depth_map.clone();
+        snapshot->shifts = m_multi_template_shifts;
+        snapshot->focal_parallax = m_focal_parallax;
+        if (m_parallax_model.isValid()) {
+            snapshot->min_parallax = m_parallax_model.minParallax();
+            snapshot->max_parallax = m_parallax_model.maxParallax();
+            for (size_t t = 0; t < m_multi_template_shifts.size(); ++t) {
+                snapshot->template_parallaxes.push_back(m_parallax_model.templateParallax(t));
+            }
+        }
+    }
+    std::atomic_store(&m_snapshot, std::shared_ptr<const SA_Snapshot>(snapshot));
+}
 bool SyntheticAperture::isVideoLoaded() const { return m_video_loaded; }
 bool SyntheticAperture::isProcessed() const { return m_is_processed; }
 
@@ -233,7 +1248,19 @@ const cv::Mat& SyntheticAperture::getDepthMap() const {
     return m_depth_map;
 }
 
+const cv::Mat& SyntheticAperture::getDepthIndex() const {
+    return m_depth_index;
+}
+
+const cv::Mat& SyntheticAperture::getDepthConfidence() const {
+    return m_depth_confidence;
+}
+
 const std::vector<cv::Point2f>& SyntheticAperture::getShifts() const {
     static const std::vector<cv::Point2f> empty_shifts;
     return m_multi_template_shifts.empty() ? empty_shifts : m_multi_template_shifts[0];
 }
+
+const std::vector<std::vector<cv::Point2f>>& SyntheticAperture::getAllShifts() const {
+    return m_multi_template_shifts;
+}
@@ -1,56 +1,267 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
+#include "FFTCorrelator.h"
+#include "ParallaxModel.h"
+#include "Metrics.h"
+#include "FrameCache.h"
+#include "FrameSource.h"
+#include "FrameStore.h"
+#include "TemplateTracker.h"
+#include "SparseMotionField.h"
+
+enum class SA_CorrelationMethod {
+    Spatial = 0,    // cv::matchTemplate per template and frame
+    FFT = 1,        // cached template spectra, one forward FFT per frame and window group
+};
+
+// correlation_method only applies to NCC. Inverse-compositional tracking costs a few iterations
+// per frame whatever the window size and is always sub-pixel; the window then only bounds
+// drift. The sparse motion field is built once per loaded video and makes further templates
+// nearly free; streaming mode tracks with inverse compositional instead, as does a clip with
+// too few trackable corners.
+enum class SA_TrackerType {
+    NCC = 0,                    // correlation search of the whole window in every frame
+    InverseCompositional = 1,   // Lucas-Kanade from the previous frame's shift, NCC where it fails
+    SparseMotion = 2,           // one shared corner-based motion field, a 1-D parallax search per template
+};
 
 //Config params
 struct SA_Parameters {
     int max_frames = 90;
+    // Frames start_frame, start_frame + frame_stride, ... before end_frame (0 = end of video),
+    // at most max_frames of them. Skipped frames are grabbed but never decoded to BGR.
+    int start_frame = 0;
+    int end_frame = 0;
+    int frame_stride = 1;
     int scale_factor = 2;
+    // Downscale of the synthetic image, 0 = scale_factor.
+    int render_scale_factor = 0;
     std::vector<cv::Point> template_points;
     int template_size = 32;
     int search_window_size = 160;
+    // NCC only: center each frame's search on a constant-velocity prediction from the previous
+    // shifts and shrink it to the recent prediction error, widening back to search_window_size
+    // when the peak is weak. Frames of a template are then tracked in order.
+    bool predictive_search = false;
     int override_width = 0;
     int override_height = 0;
     int rotation = 0;
+    // Decode frames inside process() instead of holding them all after loadVideo().
+    // Only frame 0 is kept, so memory no longer grows with max_frames.
+    bool streaming = false;
+    // Coarse-to-fine template search: number of pyrDown levels, 0 searches the full window exhaustively.
+    int pyramid_levels = 0;
+    // Refine correlation peaks below a pixel with a parabolic fit, so tracking can run at a coarser scale.
+    bool subpixel_refinement = false;
+    // FFT always searches the full window at full resolution and ignores pyramid_levels.
+    SA_CorrelationMethod correlation_method = SA_CorrelationMethod::Spatial;
+    // How templates are followed through the frames; see SA_TrackerType.
+    SA_TrackerType tracker = SA_TrackerType::NCC;
+    // Dense plane-sweep depth with this many parallax planes (at most 256). 0 draws one marker per template.
+    int depth_planes = 0;
+    // Accumulate the synthetic image in integers with 1/16 px bilinear weights instead of floats.
+    bool fixed_point_accumulation = false;
+    // Frames kept by viewpoint selection, 0 = every loaded frame.
+    int selected_frames = 0;
+    // Directory for memory-mapped caches of preprocessed frames, empty disables caching. A cache
+    // is reused while the video file and every preprocessing parameter above are unchanged.
+    std::string frame_cache_dir;
+};
+
+// Progress of the running loadVideo()/process() call: the current stage and how many of its
+// frames (or template/frame pairs) are done.
+struct SA_Progress {
+    std::string stage;
+    int done = 0;
+    int total = 0;
+};
+
+// Immutable copy of the results, published atomically when loadVideo(), process() or a
+// refocus finishes. Safe to read from another thread while the next run is in progress.
+struct SA_Snapshot {
+    bool video_loaded = false;
+    bool processed = false;
+    bool can_refocus = false;
+    cv::Mat first_color_frame;
+    cv::Mat template_image;
+    cv::Mat synthetic_image;
+    cv::Mat depth_map;
+    std::vector<std::vector<cv::Point2f>> shifts;
+    float focal_parallax = 0.0f;
+    float min_parallax = 0.0f;
+    float max_parallax = 0.0f;
+    std::vector<float> template_parallaxes;
+    SA_Metrics metrics;
 };
 
 class SyntheticAperture {
 public:
     SyntheticAperture();
+    ~SyntheticAperture();
 
     bool loadVideo(const std::string& video_path, const SA_Parameters& params);
+    // Tracks, the depth map and the synthetic image are memoized per loaded video: a call only
+    // tracks templates not yet seen with the same matching parameters and re-runs the stages
+    // whose inputs changed. Streaming mode always recomputes everything.
     bool process(const SA_Parameters& params);
 
+    // Re-renders the synthetic image focused at a relative parallax (0 = template 0, see
+    // ParallaxModel) or on a tracked template, reusing the decoded frames and shift tracks.
+    bool refocus(float parallax);
+    bool refocusOnTemplate(size_t template_index);
+    bool canRefocus() const;
+    float getFocalParallax() const;
+    float getMinParallax() const;
+    float getMaxParallax() const;
+    float getTemplateParallax(size_t template_index) const;
+
     const cv::Mat& getFirstColorFrame() const;
     const cv::Mat& getTemplateImage() const;
     const cv::Mat& getSyntheticImage() const;
     const cv::Mat& getDepthMap() const;
+    const cv::Mat& getDepthIndex() const;
+    const cv::Mat& getDepthConfidence() const;
     const std::vector<cv::Point2f>& getShifts() const;
-    const std::string& getStatusMessage() const;
+    const std::vector<std::vector<cv::Point2f>>& getAllShifts() const;
+    // Indices into the loaded frames that the shift tracks refer to, and their synthesis weights
+    // (empty when every frame counts once).
+    const std::vector<int>& getSelectedFrames() const;
+    const std::vector<int>& getFrameWeights() const;
+    std::string getStatusMessage() const;
     bool isVideoLoaded() const;
     bool isProcessed() const;
 
+    // Thread-safe; intended for a UI polling a worker thread that runs loadVideo()/process().
+    std::shared_ptr<const SA_Snapshot> getSnapshot() const;
+    SA_Progress getProgress() const;
+    const SA_Metrics& getMetrics() const;
+    void requestCancel();
+
 private:
+    bool loadVideoFrames(const std::string& video_path, const SA_Parameters& params);
+    bool runProcess(const SA_Parameters& params);
     void calculateMultiTemplateShifts();
-    void createDepthMap();
-    void createSyntheticImage();
+    void selectFrames();
+    // Fills tracks[t] over frames_gray for every t in templates, taking memoized tracks where
+    // they exist and matching (then memoizing) the rest. pair_ms, if given, receives the match
+    // times frame-major over all templates.
+    void trackTemplates(const std::vector<cv::Mat>& frames_gray, const std::string& frame_set,
+                        const std::vector<size_t>& templates, std::vector<std::vector<cv::Point2f>>& tracks,
+                        std::vector<float>* pair_ms);
+    // False if cancelled. A fit that fails leaves the field invalid but counts as built.
+    bool buildMotionField();
+    bool createDepthMap();
+    bool createDenseDepthMap();
+    bool createSyntheticImage();
+    // False if cancelled or the video could not be decoded again.
+    bool renderSyntheticImage(const std::vector<cv::Point2f>& shifts);
+    bool renderFromVideo(const std::vector<cv::Point2f>& shifts);
+    // Empty without a frame cache directory.
+    std::string renderCacheKey() const;
+    std::string renderCachePath() const;
+    void releaseRenderCache();
+    bool buildRenderCache(const std::string& key);
+    int renderScaleFactor() const;
+    bool rendersFromVideo() const;
+    bool processStreaming();
+    void prepareTemplates();
+    std::string trackKey(size_t template_index, const std::string& frame_set) const;
+    std::string depthInputsKey() const;
+    std::string synthesisInputsKey() const;
+    void resetMemoizedResults();
+
+    void setStatus(const std::string& message);
+    void setStage(const std::string& stage, int total);
+    void advanceProgress();
+    bool checkCancelled();
+    void publishSnapshot();
+    void beginProcessMetrics();
+    double processClockMs() const;
+    void addStage(const std::string& name, double start_ms, double duration_ms);
+    void recordMatchLatencies(const std::vector<float>& pair_ms, size_t num_templates, size_t num_matched);
+    size_t frameStoreBytes() const;
+
+    bool decodeVideoFrames(const std::string& video_path, int frames_to_load);
+    FrameSource selectedFrames(int max_frames) const;
+    std::string frameCacheKey(const std::string& video_path, const SA_Parameters& params) const;
+    cv::Size uprightFrameSize(const cv::Size& source) const;
+    cv::Size targetFrameSize(const cv::Size& source, int scale_factor) const;
+    // Override size, rotation and downscale by scale_factor, into a CV_8UC3 frame.
+    void resampleFrame(const cv::Mat& frame, cv::Mat& color, int scale_factor) const;
+    void preprocessFrame(const cv::Mat& frame, cv::Mat& color, cv::Mat& gray) const;
+    cv::Rect searchWindowRect(size_t template_index, const cv::Size& frame_size) const;
+    bool useFFTCorrelator() const;
+    // histories[t] holds template t's shifts in the earlier frames, for trackers that follow
+    // templates from frame to frame; it may be empty when every tracker is independent.
+    void matchAllTemplatesInFrame(const cv::Mat& frame_gray, const std::vector<std::vector<cv::Point2f>>& histories,
+                                  std::vector<cv::Point2f>& shifts, std::vector<float>* latencies_ms = nullptr) const;
 
     SA_Parameters m_params;
+    SA_Parameters m_load_params;
+    std::string m_video_path;
     std::string m_status_message;
+    mutable std::mutex m_status_mutex;
+    std::string m_stage;
+    std::atomic<int> m_progress_done;
+    std::atomic<int> m_progress_total;
+    std::atomic<bool> m_cancel_requested;
+    std::shared_ptr<const SA_Snapshot> m_snapshot;
+    SA_Metrics m_metrics;
+    SA_Clock::time_point m_process_start;
 
-    std::vector<cv::Mat> m_frames_gray;
-    std::vector<cv::Mat> m_frames_color;
+    cv::Mat m_first_gray_frame;
+    FrameStore m_frames;
+    // Backs m_frames when it views frames mapped from the frame cache.
+    MappedFrameCache m_frame_cache;
+    // The active frames at the render scale when that differs from the tracking scale, mapped
+    // from the frame cache directory so refocusing neither decodes the clip nor holds them.
+    MappedFrameCache m_render_cache;
+    std::string m_render_cache_key;
+    std::string m_render_cache_temp_path;   // set while the render cache is a temporary file
+    // Headers onto the frames selected for tracking and synthesis (all of them without
+    // selection). m_frame_set names the selection in memoization keys, empty for all frames.
+    std::vector<cv::Mat> m_active_frames_gray;
+    std::vector<cv::Mat> m_active_frames_color;
+    std::vector<int> m_selected_frames;
+    std::vector<int> m_frame_weights;
+    std::string m_frame_set;
 
     cv::Mat m_first_color_frame;
     cv::Mat m_template_image;
     cv::Mat m_synthetic_image;
 
     cv::Mat m_depth_map;
+    cv::Mat m_depth_index;
+    cv::Mat m_depth_confidence;
+    ParallaxModel m_parallax_model;
+    float m_focal_parallax = 0.0f;
     std::vector<float> m_parallaxes;
     std::vector<std::vector<cv::Point2f>> m_multi_template_shifts;
+    std::vector<std::vector<cv::Mat>> m_template_pyramids;
+    std::vector<std::unique_ptr<TemplateTracker>> m_trackers;
+    FFTCorrelator m_fft_correlator;
+    // Templates matched in the current tracking pass; matchAllTemplatesInFrame() returns one
+    // shift per entry, in this order.
+    std::vector<size_t> m_tracked_templates;
+
+    // Memoized stage results. Tracks are keyed by trackKey(); the depth map and synthetic image
+    // remember the key of the inputs they were built from (tracks -> depth, track 0 ->
+    // synthesis) and are rebuilt only when it changes. All of it is dropped on loadVideo().
+    std::map<std::string, std::vector<cv::Point2f>> m_track_cache;
+    // Built over every loaded frame, whatever the selection, so LK only steps between neighbors.
+    SparseMotionField m_motion_field;
+    bool m_motion_field_built = false;
+    std::string m_depth_inputs;
+    std::string m_synthesis_inputs;
 
-    bool m_video_loaded;
-    bool m_is_processed;
+    std::atomic<bool> m_video_loaded;
+    std::atomic<bool> m_is_processed;
+    std::string m_render_cache_owner;
 };
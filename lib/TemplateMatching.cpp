@@ -0,0 +1,84 @@
+#include "TemplateMatching.h"
+
+static const int kMinPyramidTemplateSize = 8;
+
+std::vector<cv::Mat> buildTemplatePyramid(const cv::Mat& template_image, int max_levels) {
+    std::vector<cv::Mat> pyramid = { template_image };
+    for (int level = 0; level < max_levels; ++level) {
+        const cv::Mat& prev = pyramid.back();
+        if (prev.cols / 2 < kMinPyramidTemplateSize || prev.rows / 2 < kMinPyramidTemplateSize) break;
+        cv::Mat down;
+        cv::pyrDown(prev, down);
+        pyramid.push_back(down);
+    }
+    return pyramid;
+}
+
+// Vertex of the parabola through (-1, l), (0, c), (1, r); 0 when c is not a strict maximum.
+static float parabolicOffset(float l, float c, float r) {
+    float denom = l - 2.0f * c + r;
+    if (denom >= 0.0f) return 0.0f;
+    return std::max(-0.5f, std::min(0.5f, 0.5f * (l - r) / denom));
+}
+
+cv::Point2f refinePeakSubpixel(const cv::Mat& correlation_map, const cv::Point& peak) {
+    cv::Point2f refined(peak.x, peak.y);
+    float c = correlation_map.at<float>(peak.y, peak.x);
+    if (peak.x > 0 && peak.x < correlation_map.cols - 1) {
+        refined.x += parabolicOffset(correlation_map.at<float>(peak.y, peak.x - 1), c, correlation_map.at<float>(peak.y, peak.x + 1));
+    }
+    if (peak.y > 0 && peak.y < correlation_map.rows - 1) {
+        refined.y += parabolicOffset(correlation_map.at<float>(peak.y - 1, peak.x), c, correlation_map.at<float>(peak.y + 1, peak.x));
+    }
+    return refined;
+}
+
+static cv::Point2f findPeak(const cv::Mat& search_window, const NCCTemplate& template_image, bool subpixel, float* peak_score = nullptr) {
+    cv::Mat correlation_map;
+    template_image.match(search_window, correlation_map);
+
+    double max_value;
+    cv::Point peak_loc;
+    cv::minMaxLoc(correlation_map, nullptr, &max_value, nullptr, &peak_loc);
+    if (peak_score) *peak_score = (float)max_value;
+    return subpixel ? refinePeakSubpixel(correlation_map, peak_loc) : cv::Point2f(peak_loc.x, peak_loc.y);
+}
+
+cv::Point2f matchTemplateExhaustive(const cv::Mat& search_window, const NCCTemplate& template_image, bool subpixel, float* peak_score) {
+    return findPeak(search_window, template_image, subpixel, peak_score);
+}
+
+cv::Point2f matchTemplatePyramid(const cv::Mat& search_window, const std::vector<NCCTemplate>& template_pyramid, bool subpixel, int refine_radius,
+                                 float* peak_score) {
+    std::vector<cv::Mat> window_pyramid = { search_window };
+    size_t levels = 1;
+    while (levels < template_pyramid.size()) {
+        cv::Mat down;
+        cv::pyrDown(window_pyramid.back(), down);
+        const NCCTemplate& templ = template_pyramid[levels];
+        if (down.cols < templ.cols() || down.rows < templ.rows()) break;
+        window_pyramid.push_back(down);
+        levels++;
+    }
+
+    // Only the finest level is refined below a pixel; coarser peaks just seed the next level.
+    cv::Point2f peak = findPeak(window_pyramid[levels - 1], template_pyramid[levels - 1], subpixel && levels == 1, peak_score);
+
+    for (int level = (int)levels - 2; level >= 0; --level) {
+        const cv::Mat& window = window_pyramid[level];
+        const NCCTemplate& templ = template_pyramid[level];
+        bool refine = subpixel && level == 0;
+        cv::Point center(cvRound(peak.x) * 2, cvRound(peak.y) * 2);
+
+        cv::Rect refine_roi(center.x - refine_radius, center.y - refine_radius,
+                            templ.cols() + 2 * refine_radius, templ.rows() + 2 * refine_radius);
+        refine_roi &= cv::Rect(0, 0, window.cols, window.rows);
+        if (refine_roi.width < templ.cols() || refine_roi.height < templ.rows()) {
+            // The upsampled peak fell off the edge of this level; search it in full.
+            peak = findPeak(window, templ, refine, peak_score);
+            continue;
+        }
+        peak = findPeak(window(refine_roi), templ, refine, peak_score) + cv::Point2f(refine_roi.x, refine_roi.y);
+    }
+    return peak;
+}
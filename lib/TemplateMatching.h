@@ -0,0 +1,23 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include "NCCTemplate.h"
+
+// Builds [template, pyrDown(template), ...] with at most max_levels decimations. Levels stop
+// early once the template would shrink below a size that still correlates reliably.
+std::vector<cv::Mat> buildTemplatePyramid(const cv::Mat& template_image, int max_levels);
+
+// Fits a parabola through the peak and its direct neighbors along each axis of a CV_32F
+// correlation map. Offsets are clamped to half a pixel; border peaks stay integer.
+cv::Point2f refinePeakSubpixel(const cv::Mat& correlation_map, const cv::Point& peak);
+
+// Exhaustive TM_CCOEFF_NORMED search. Returns the peak's top-left corner in search_window
+// coordinates, optionally refined below a pixel; peak_score, if given, receives its correlation.
+cv::Point2f matchTemplateExhaustive(const cv::Mat& search_window, const NCCTemplate& template_image, bool subpixel = false,
+                                    float* peak_score = nullptr);
+
+// Coarse-to-fine TM_CCOEFF_NORMED search: the full window is only searched at the coarsest
+// level, every finer level re-searches a +/- refine_radius neighborhood of the upsampled peak.
+cv::Point2f matchTemplatePyramid(const cv::Mat& search_window, const std::vector<NCCTemplate>& template_pyramid, bool subpixel = false,
+                                 int refine_radius = 2, float* peak_score = nullptr);
@@ -0,0 +1,124 @@
+#include "TemplateTracker.h"
+#include "TemplateMatching.h"
+
+static const int kMaxIterations = 20;
+// Iteration stops once an update moves the template by less than this many pixels.
+static const double kConvergedStep = 0.01;
+// Smallest det(H) / trace(H)^2 still trusted; below it the template lacks texture in one direction.
+static const double kMinHessianConditioning = 1e-4;
+// Predictive search margin: kErrorFactor times the largest constant-velocity prediction error
+// of the last kErrorHistory frames, plus kMinSearchMargin pixels.
+static const int kErrorHistory = 5;
+static const float kErrorFactor = 2.0f;
+static const int kMinSearchMargin = 4;
+// Predicted-window peaks below this correlation are searched again in the full-size window.
+static const float kMinPeakScore = 0.6f;
+
+cv::Rect searchWindowAround(const cv::Point& origin, int template_size, int window_size, const cv::Size& frame_size) {
+    int search_margin = (window_size - template_size) / 2;
+    cv::Rect search_window_roi(origin.x - search_margin, origin.y - search_margin, window_size, window_size);
+    return search_window_roi & cv::Rect(0, 0, frame_size.width, frame_size.height);
+}
+
+NCCTracker::NCCTracker(const std::vector<cv::Mat>& template_pyramid, const cv::Point& origin, int search_window_size, bool subpixel,
+                       bool predictive)
+    : m_origin(origin), m_search_window_size(search_window_size), m_subpixel(subpixel), m_predictive(predictive) {
+    for (const auto& level : template_pyramid) m_template_pyramid.emplace_back(level);
+}
+
+cv::Point2f NCCTracker::search(const cv::Mat& frame_gray, const cv::Point& center_shift, int window_size, float* peak_score,
+                               bool* on_border) const {
+    const NCCTemplate& templ = m_template_pyramid[0];
+    cv::Rect search_window_roi = searchWindowAround(m_origin + center_shift, templ.cols(), window_size, frame_gray.size());
+    if (search_window_roi.width < templ.cols() || search_window_roi.height < templ.rows()) {
+        // Only a predicted window can leave the frame this far; report it as a failed search.
+        if (peak_score) *peak_score = -1.0f;
+        if (on_border) *on_border = true;
+        return cv::Point2f((float)center_shift.x, (float)center_shift.y);
+    }
+    cv::Mat search_window = frame_gray(search_window_roi);
+    cv::Point2f peak_loc = m_template_pyramid.size() > 1 ? matchTemplatePyramid(search_window, m_template_pyramid, m_subpixel, 2, peak_score)
+                                                         : matchTemplateExhaustive(search_window, templ, m_subpixel, peak_score);
+    if (on_border) {
+        float max_x = (float)(search_window_roi.width - templ.cols());
+        float max_y = (float)(search_window_roi.height - templ.rows());
+        *on_border = peak_loc.x < 1.0f || peak_loc.y < 1.0f || peak_loc.x > max_x - 1.0f || peak_loc.y > max_y - 1.0f;
+    }
+
+    float sx = (search_window_roi.x + peak_loc.x) - m_origin.x;
+    float sy = (search_window_roi.y + peak_loc.y) - m_origin.y;
+    return cv::Point2f(sx, sy);
+}
+
+cv::Point2f NCCTracker::track(const cv::Mat& frame_gray, const std::vector<cv::Point2f>& history) const {
+    const size_t n = history.size();
+    if (!m_predictive || n < 2) return search(frame_gray, cv::Point(0, 0), m_search_window_size, nullptr, nullptr);
+
+    cv::Point2f predicted = history[n - 1] * 2.0f - history[n - 2];
+    float max_error = 0.0f;
+    for (size_t k = std::max<size_t>(2, n - std::min<size_t>(n, kErrorHistory)); k < n; ++k) {
+        cv::Point2f error = history[k] - (history[k - 1] * 2.0f - history[k - 2]);
+        max_error = std::max(max_error, (float)cv::norm(error));
+    }
+    const int template_size = m_template_pyramid[0].cols();
+    const int full_margin = (m_search_window_size - template_size) / 2;
+    const int margin = std::min(full_margin, kMinSearchMargin + (int)std::ceil(kErrorFactor * max_error));
+    const cv::Point center(cvRound(predicted.x), cvRound(predicted.y));
+
+    float peak_score;
+    bool on_border;
+    cv::Point2f shift = search(frame_gray, center, template_size + 2 * margin, &peak_score, &on_border);
+    if (peak_score >= kMinPeakScore && !on_border) return shift;
+    shift = search(frame_gray, center, m_search_window_size, &peak_score, nullptr);
+    if (peak_score >= 0.0f) return shift;
+    return search(frame_gray, cv::Point(0, 0), m_search_window_size, nullptr, nullptr);
+}
+
+InverseCompositionalTracker::InverseCompositionalTracker(const std::vector<cv::Mat>& template_pyramid, const cv::Point& origin,
+                                                         int search_window_size, bool subpixel)
+    : m_origin(origin), m_search_window_size(search_window_size), m_fallback(template_pyramid, origin, search_window_size, subpixel) {
+    template_pyramid[0].convertTo(m_template, CV_32F);
+    // Central differences, the same derivative the bilinear patch sampling linearizes.
+    cv::Sobel(m_template, m_grad_x, CV_32F, 1, 0, 1, 0.5, 0, cv::BORDER_REPLICATE);
+    cv::Sobel(m_template, m_grad_y, CV_32F, 0, 1, 1, 0.5, 0, cv::BORDER_REPLICATE);
+    m_template -= cv::mean(m_template)[0];
+
+    double gxx = m_grad_x.dot(m_grad_x);
+    double gxy = m_grad_x.dot(m_grad_y);
+    double gyy = m_grad_y.dot(m_grad_y);
+    double trace = gxx + gyy;
+    double det = gxx * gyy - gxy * gxy;
+    m_well_conditioned = trace > 0.0 && det > kMinHessianConditioning * trace * trace;
+    m_inv_hessian = m_well_conditioned ? cv::Matx22d(gyy, -gxy, -gxy, gxx) * (1.0 / det) : cv::Matx22d::zeros();
+}
+
+cv::Point2f InverseCompositionalTracker::track(const cv::Mat& frame_gray, const std::vector<cv::Point2f>& history) const {
+    if (!m_well_conditioned) return m_fallback.track(frame_gray, history);
+
+    const cv::Size size = m_template.size();
+    const cv::Rect window = searchWindowAround(m_origin, size.width, m_search_window_size, frame_gray.size());
+    const cv::Point2f center_offset((size.width - 1) * 0.5f, (size.height - 1) * 0.5f);
+    auto inWindow = [&](const cv::Point2f& shift) {
+        float x = m_origin.x + shift.x, y = m_origin.y + shift.y;
+        return x >= window.x && y >= window.y && x <= window.x + window.width - size.width && y <= window.y + window.height - size.height;
+    };
+
+    cv::Point2f shift = history.empty() ? cv::Point2f(0, 0) : history.back();
+    cv::Mat patch;
+    for (int iteration = 0; iteration < kMaxIterations && inWindow(shift); ++iteration) {
+        cv::Point2f top_left(m_origin.x + shift.x, m_origin.y + shift.y);
+        cv::getRectSubPix(frame_gray, size, top_left + center_offset, patch, CV_32F);
+        patch -= cv::mean(patch)[0];
+        patch -= m_template;
+
+        cv::Vec2d step = m_inv_hessian * cv::Vec2d(m_grad_x.dot(patch), m_grad_y.dot(patch));
+        // Inverse composition for a translation: W(p) <- W(p) o W(step)^-1, i.e. p -= step.
+        shift.x -= (float)step[0];
+        shift.y -= (float)step[1];
+        if (step.dot(step) < kConvergedStep * kConvergedStep) {
+            if (inWindow(shift)) return shift;
+            break;
+        }
+    }
+    return m_fallback.track(frame_gray, history);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include "NCCTemplate.h"
+
+// Square search window of window_size pixels centered on a template at origin, clipped to the frame.
+cv::Rect searchWindowAround(const cv::Point& origin, int template_size, int window_size, const cv::Size& frame_size);
+
+// Follows one template, cut from frame 0 at its origin, through later frames. track() returns
+// the shift of the origin in frame_gray. Trackers are immutable once built, so one instance
+// can serve several threads; whatever they need of the past is passed in as history.
+class TemplateTracker {
+public:
+    virtual ~TemplateTracker() = default;
+
+    // history holds the template's shifts in every earlier frame, oldest first, starting with
+    // frame 0's (0, 0). It may be empty for trackers that match frames independently.
+    virtual cv::Point2f track(const cv::Mat& frame_gray, const std::vector<cv::Point2f>& history) const = 0;
+    // True if track() ignores history, so frames may be tracked in any order.
+    virtual bool independentFrames() const = 0;
+};
+
+// TM_CCOEFF_NORMED search, exhaustive or coarse-to-fine depending on the pyramid's depth.
+//
+// By default the whole search window around the template's frame-0 origin is searched in
+// every frame. A predictive tracker instead centers the window on a constant-velocity
+// prediction from the last two shifts and shrinks it to the largest recent prediction error
+// plus a margin, so smooth sweeps correlate a small patch per frame however far they travel.
+// A weak peak, or one on the shrunk window's border, widens the search back to the full
+// window size around the prediction.
+class NCCTracker : public TemplateTracker {
+public:
+    NCCTracker(const std::vector<cv::Mat>& template_pyramid, const cv::Point& origin, int search_window_size, bool subpixel,
+               bool predictive = false);
+
+    cv::Point2f track(const cv::Mat& frame_gray, const std::vector<cv::Point2f>& history) const override;
+    bool independentFrames() const override { return !m_predictive; }
+
+private:
+    // Searches a window_size window centered on the template displaced by center_shift.
+    cv::Point2f search(const cv::Mat& frame_gray, const cv::Point& center_shift, int window_size, float* peak_score,
+                       bool* on_border) const;
+
+    std::vector<NCCTemplate> m_template_pyramid;
+    cv::Point m_origin;
+    int m_search_window_size;
+    bool m_subpixel;
+    bool m_predictive;
+};
+
+// Inverse-compositional Lucas-Kanade for a pure translation, with the template's and the
+// warped patch's means removed so global brightness changes do not bias it. The template
+// gradients and the 2x2 Hessian are computed once, so an iteration costs one bilinear patch
+// sample and two dot products, independent of the search window. Each frame starts from the
+// previous frame's shift, which suits smooth sweeps moving a few pixels per frame; a frame
+// that does not converge, or drifts out of the search window, falls back to NCC search.
+class InverseCompositionalTracker : public TemplateTracker {
+public:
+    InverseCompositionalTracker(const std::vector<cv::Mat>& template_pyramid, const cv::Point& origin, int search_window_size, bool subpixel);
+
+    cv::Point2f track(const cv::Mat& frame_gray, const std::vector<cv::Point2f>& history) const override;
+    bool independentFrames() const override { return false; }
+
+private:
+    cv::Mat m_template;         // CV_32F, zero mean
+    cv::Mat m_grad_x;
+    cv::Mat m_grad_y;
+    cv::Matx22d m_inv_hessian;
+    bool m_well_conditioned;    // false for textureless templates, which always take the fallback
+    cv::Point m_origin;
+    int m_search_window_size;
+    NCCTracker m_fallback;
+};
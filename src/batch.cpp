@@ -0,0 +1,329 @@
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "SyntheticAperture.h"
+
+namespace fs = std::filesystem;
+
+struct BatchClip {
+    std::string video_path;
+    std::string output_stem;
+    std::vector<cv::Point> template_points;
+};
+
+struct BatchJob {
+    SA_Parameters params;
+    std::vector<BatchClip> clips;
+    std::string output_dir = "batch_output";
+    int workers = 0;
+};
+
+static std::mutex g_log_mutex;
+
+static void Log(const std::string& message) {
+    std::lock_guard<std::mutex> lock(g_log_mutex);
+    std::cout << message << std::endl;
+}
+
+static bool IsVideoFile(const fs::path& path) {
+    static const std::set<std::string> extensions = { ".mp4", ".mov", ".avi", ".mkv", ".m4v", ".webm" };
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return extensions.count(ext) > 0;
+}
+
+// Template points are stored flat as [x0, y0, x1, y1, ...].
+static std::vector<cv::Point> ReadTemplatePoints(const cv::FileNode& node) {
+    std::vector<cv::Point> points;
+    if (node.empty() || !node.isSeq()) return points;
+    std::vector<int> coords;
+    node >> coords;
+    for (size_t i = 0; i + 1 < coords.size(); i += 2) {
+        points.emplace_back(coords[i], coords[i + 1]);
+    }
+    return points;
+}
+
+static void ReadParameters(const cv::FileNode& node, SA_Parameters& params) {
+    if (node.empty()) return;
+    if (!node["max_frames"].empty()) node["max_frames"] >> params.max_frames;
+    if (!node["start_frame"].empty()) node["start_frame"] >> params.start_frame;
+    if (!node["end_frame"].empty()) node["end_frame"] >> params.end_frame;
+    if (!node["frame_stride"].empty()) node["frame_stride"] >> params.frame_stride;
+    if (!node["scale_factor"].empty()) node["scale_factor"] >> params.scale_factor;
+    if (!node["render_scale_factor"].empty()) node["render_scale_factor"] >> params.render_scale_factor;
+    if (!node["template_size"].empty()) node["template_size"] >> params.template_size;
+    if (!node["search_window_size"].empty()) node["search_window_size"] >> params.search_window_size;
+    if (!node["predictive_search"].empty()) node["predictive_search"] >> params.predictive_search;
+    if (!node["override_width"].empty()) node["override_width"] >> params.override_width;
+    if (!node["override_height"].empty()) node["override_height"] >> params.override_height;
+    if (!node["rotation"].empty()) node["rotation"] >> params.rotation;
+    if (!node["streaming"].empty()) node["streaming"] >> params.streaming;
+    if (!node["pyramid_levels"].empty()) node["pyramid_levels"] >> params.pyramid_levels;
+    if (!node["subpixel_refinement"].empty()) node["subpixel_refinement"] >> params.subpixel_refinement;
+    if (!node["depth_planes"].empty()) node["depth_planes"] >> params.depth_planes;
+    if (!node["fixed_point_accumulation"].empty()) node["fixed_point_accumulation"] >> params.fixed_point_accumulation;
+    if (!node["selected_frames"].empty()) node["selected_frames"] >> params.selected_frames;
+    if (!node["frame_cache_dir"].empty()) params.frame_cache_dir = (std::string)node["frame_cache_dir"];
+    if (!node["correlation_method"].empty()) {
+        std::string method = (std::string)node["correlation_method"];
+        params.correlation_method = (method == "fft") ? SA_CorrelationMethod::FFT : SA_CorrelationMethod::Spatial;
+    }
+    if (!node["tracker"].empty()) {
+        std::string tracker = (std::string)node["tracker"];
+        if (tracker == "ic") params.tracker = SA_TrackerType::InverseCompositional;
+        else if (tracker == "sparse") params.tracker = SA_TrackerType::SparseMotion;
+        else params.tracker = SA_TrackerType::NCC;
+    }
+    if (!node["template_points"].empty()) params.template_points = ReadTemplatePoints(node["template_points"]);
+}
+
+// Rejects values that would make OpenCV throw or loop on every clip, naming the first bad one.
+static bool ValidateParameters(const SA_Parameters& params, std::string& error) {
+    if (params.scale_factor < 1) error = "scale_factor must be at least 1";
+    else if (params.template_size < 1) error = "template_size must be at least 1";
+    else if (params.search_window_size < params.template_size) error = "search_window_size must be at least template_size";
+    else if (params.max_frames < 0) error = "max_frames must not be negative";
+    else if (params.frame_stride < 0) error = "frame_stride must not be negative";
+    return error.empty();
+}
+
+static void AddVideosFromDirectory(const fs::path& dir, std::vector<BatchClip>& clips) {
+    std::vector<fs::path> found;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (entry.is_regular_file() && IsVideoFile(entry.path())) found.push_back(entry.path());
+    }
+    std::sort(found.begin(), found.end());
+    for (const auto& path : found) clips.push_back({ path.string(), "", {} });
+}
+
+// Manifest: one video path per line, relative to the manifest. '#' starts a comment.
+static bool AddVideosFromManifest(const fs::path& manifest, std::vector<BatchClip>& clips) {
+    std::ifstream in(manifest);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        line.erase(std::find(line.begin(), line.end(), '#'), line.end());
+        line.erase(0, line.find_first_not_of(" \t\r"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (line.empty()) continue;
+        fs::path path(line);
+        if (path.is_relative()) path = manifest.parent_path() / path;
+        clips.push_back({ path.string(), "", {} });
+    }
+    return true;
+}
+
+static bool LoadJob(const std::string& job_path, BatchJob& job) {
+    cv::FileStorage fs_job(job_path, cv::FileStorage::READ);
+    if (!fs_job.isOpened()) {
+        std::cerr << "FATAL ERROR: Cannot open job file '" << job_path << "'" << std::endl;
+        return false;
+    }
+    fs::path job_dir = fs::path(job_path).parent_path();
+    auto resolve = [&](const std::string& p) {
+        fs::path path(p);
+        return path.is_relative() ? (job_dir / path) : path;
+    };
+
+    ReadParameters(fs_job["params"], job.params);
+    std::string error;
+    if (!ValidateParameters(job.params, error)) {
+        std::cerr << "FATAL ERROR: Invalid params in '" << job_path << "': " << error << std::endl;
+        return false;
+    }
+    if (!fs_job["output_dir"].empty()) job.output_dir = resolve((std::string)fs_job["output_dir"]).string();
+    if (!fs_job["workers"].empty()) fs_job["workers"] >> job.workers;
+
+    // "videos" entries are either plain paths or maps with "path" and optional "template_points".
+    cv::FileNode videos = fs_job["videos"];
+    if (!videos.empty()) {
+        for (const auto& entry : videos) {
+            BatchClip clip;
+            if (entry.isString()) {
+                clip.video_path = resolve((std::string)entry).string();
+            } else {
+                clip.video_path = resolve((std::string)entry["path"]).string();
+                clip.template_points = ReadTemplatePoints(entry["template_points"]);
+            }
+            job.clips.push_back(clip);
+        }
+    }
+    if (!fs_job["video_dir"].empty()) {
+        fs::path dir = resolve((std::string)fs_job["video_dir"]);
+        if (!fs::is_directory(dir)) {
+            std::cerr << "FATAL ERROR: Video directory not found at '" << dir.string() << "'" << std::endl;
+            return false;
+        }
+        AddVideosFromDirectory(dir, job.clips);
+    }
+    if (!fs_job["manifest"].empty()) {
+        fs::path manifest = resolve((std::string)fs_job["manifest"]);
+        if (!AddVideosFromManifest(manifest, job.clips)) {
+            std::cerr << "FATAL ERROR: Cannot read manifest '" << manifest.string() << "'" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Repeated stems get the first "_N" suffix that is neither assigned yet nor any input's own stem.
+static void AssignOutputStems(std::vector<BatchClip>& clips) {
+    std::set<std::string> input_stems;
+    for (const auto& clip : clips) input_stems.insert(fs::path(clip.video_path).stem().string());
+    std::set<std::string> used;
+    for (auto& clip : clips) {
+        const std::string base = fs::path(clip.video_path).stem().string();
+        std::string stem = base;
+        for (int n = 1; used.count(stem) || (stem != base && input_stems.count(stem)); ++n) stem = base + "_" + std::to_string(n);
+        used.insert(stem);
+        clip.output_stem = stem;
+    }
+}
+
+// frames maps a track index to the loaded frame it was measured on; the frame column holds
+// that frame's number in the source video, given the job's start_frame and frame_stride.
+static bool WriteShiftTracks(const std::string& path, const std::vector<std::vector<cv::Point2f>>& tracks, const std::vector<int>& frames,
+                             const SA_Parameters& params) {
+    std::ofstream out(path);
+    if (!out) return false;
+    const int start = std::max(0, params.start_frame);
+    const int stride = std::max(1, params.frame_stride);
+    out << "template,frame,dx,dy\n";
+    for (size_t t = 0; t < tracks.size(); ++t) {
+        for (size_t i = 0; i < tracks[t].size(); ++i) {
+            int loaded = i < frames.size() ? frames[i] : (int)i;
+            out << t << "," << start + loaded * stride << "," << tracks[t][i].x << "," << tracks[t][i].y << "\n";
+        }
+    }
+    return (bool)out;
+}
+
+static bool RunClip(const BatchClip& clip, const SA_Parameters& job_params, const fs::path& output_dir, std::string& error) {
+    SA_Parameters params = job_params;
+    if (!clip.template_points.empty()) params.template_points = clip.template_points;
+
+    SyntheticAperture processor;
+    if (!processor.loadVideo(clip.video_path, params) || !processor.process(params)) {
+        error = processor.getStatusMessage();
+        return false;
+    }
+
+    fs::path base = output_dir / clip.output_stem;
+    if (!cv::imwrite(base.string() + "_synthetic.png", processor.getSyntheticImage()) ||
+        !cv::imwrite(base.string() + "_depth.png", processor.getDepthMap()) ||
+        !WriteShiftTracks(base.string() + "_shifts.csv", processor.getAllShifts(), processor.getSelectedFrames(), params)) {
+        error = "Failed to write outputs to '" + output_dir.string() + "'";
+        return false;
+    }
+    std::ofstream metrics_out(base.string() + "_metrics.json");
+    metrics_out << processor.getMetrics().toJson();
+    if (!metrics_out) {
+        error = "Failed to write metrics to '" + output_dir.string() + "'";
+        return false;
+    }
+    if (!processor.getDepthIndex().empty()) {
+        cv::Mat confidence_8u;
+        processor.getDepthConfidence().convertTo(confidence_8u, CV_8U, 255.0);
+        if (!cv::imwrite(base.string() + "_depth_index.png", processor.getDepthIndex()) ||
+            !cv::imwrite(base.string() + "_depth_confidence.png", confidence_8u)) {
+            error = "Failed to write depth outputs to '" + output_dir.string() + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+// An exception from one clip, e.g. OpenCV rejecting a frame or running out of memory, fails
+// that clip only, so the rest of the batch still runs.
+static bool ProcessClip(const BatchClip& clip, const SA_Parameters& job_params, const fs::path& output_dir, std::string& error) {
+    try {
+        return RunClip(clip, job_params, output_dir, error);
+    } catch (const std::exception& e) {
+        error = std::string("Exception: ") + e.what();
+    } catch (...) {
+        error = "Unknown exception";
+    }
+    return false;
+}
+
+static void PrintUsage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " <job.yml|job.json> [--workers N] [--output DIR]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    BatchJob job;
+    if (!LoadJob(argv[1], job)) return 1;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--workers" && i + 1 < argc) {
+            job.workers = std::atoi(argv[++i]);
+        } else if (arg == "--output" && i + 1 < argc) {
+            job.output_dir = argv[++i];
+        } else {
+            PrintUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (job.clips.empty()) {
+        std::cerr << "Error: The job file lists no videos." << std::endl;
+        return 1;
+    }
+    AssignOutputStems(job.clips);
+
+    std::error_code ec;
+    fs::create_directories(job.output_dir, ec);
+    if (ec) {
+        std::cerr << "FATAL ERROR: Cannot create output directory '" << job.output_dir << "': " << ec.message() << std::endl;
+        return 1;
+    }
+
+    int hardware_threads = std::max(1, (int)std::thread::hardware_concurrency());
+    int workers = job.workers > 0 ? job.workers : hardware_threads;
+    workers = std::min(workers, (int)job.clips.size());
+    // Clips are the unit of parallelism; split what is left of the machine among OpenCV's own loops.
+    cv::setNumThreads(std::max(1, hardware_threads / workers));
+
+    Log("Processing " + std::to_string(job.clips.size()) + " clips with " + std::to_string(workers) + " workers.");
+    auto start = std::chrono::steady_clock::now();
+
+    std::atomic<size_t> next_clip(0);
+    std::atomic<int> failures(0);
+    std::vector<std::thread> pool;
+    for (int w = 0; w < workers; ++w) {
+        pool.emplace_back([&]() {
+            for (size_t i = next_clip++; i < job.clips.size(); i = next_clip++) {
+                const BatchClip& clip = job.clips[i];
+                std::string error;
+                if (ProcessClip(clip, job.params, job.output_dir, error)) {
+                    Log("[" + std::to_string(i + 1) + "/" + std::to_string(job.clips.size()) + "] OK     " + clip.video_path);
+                } else {
+                    failures++;
+                    Log("[" + std::to_string(i + 1) + "/" + std::to_string(job.clips.size()) + "] FAILED " + clip.video_path + ": " + error);
+                }
+            }
+        });
+    }
+    for (auto& t : pool) t.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    Log("Finished " + std::to_string(job.clips.size() - failures) + "/" + std::to_string(job.clips.size()) +
+        " clips in " + std::to_string(seconds) + " s.");
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,425 @@
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "SyntheticAperture.h"
+#include "NCCTemplate.h"
+
+namespace fs = std::filesystem;
+
+// Scene layout: the frame is split into a grid with one cell per template. Each cell holds a
+// textured card on one of the depth layers (layer 0 is the background, seen through empty
+// cells), and the template sits at the cell centre. Layer k moves by parallax[k] * camera[i],
+// so the true shift of every template in every frame is known exactly.
+struct SceneConfig {
+    int width = 1280;
+    int height = 720;
+    int frames = 60;
+    int templates = 4;
+    int layers = 4;
+    float max_shift = 20.0f;   // largest layer displacement, in tracking (downscaled) pixels
+    std::string path = "circle";
+    int seed = 1;
+};
+
+struct Scene {
+    std::string video_path;
+    std::vector<cv::Point> template_points;          // downscaled frame-0 coordinates
+    std::vector<std::vector<cv::Point2f>> truth;     // [template][frame], downscaled pixels
+};
+
+struct BenchResult {
+    std::string name;
+    double load_ms = 0.0;
+    double tracking_ms = 0.0;
+    double depth_ms = 0.0;
+    double synthesis_ms = 0.0;
+    double total_ms = 0.0;
+    double mean_error = 0.0;
+    double rms_error = 0.0;
+    double max_error = 0.0;
+};
+
+struct Variant {
+    std::string name;
+    SA_Parameters params;
+};
+
+static std::vector<cv::Point2f> GenerateCameraPath(const SceneConfig& config) {
+    std::vector<cv::Point2f> camera(config.frames);
+    if (config.path == "walk") {
+        // Smoothed random walk, normalised so the largest excursion is 1.
+        cv::RNG rng(config.seed);
+        cv::Point2f velocity(0, 0), position(0, 0);
+        float extent = 1e-6f;
+        for (int i = 0; i < config.frames; ++i) {
+            camera[i] = position;
+            extent = std::max(extent, (float)cv::norm(position));
+            velocity = 0.8f * velocity + 0.2f * cv::Point2f((float)rng.gaussian(1.0), (float)rng.gaussian(1.0));
+            position += velocity;
+        }
+        for (auto& c : camera) c /= extent;
+    } else {
+        // Lissajous loop starting at the origin.
+        for (int i = 0; i < config.frames; ++i) {
+            double phase = 2.0 * CV_PI * i / std::max(1, config.frames);
+            camera[i] = cv::Point2f((float)std::sin(phase), (float)(std::sin(2.0 * phase) / 2.0));
+        }
+    }
+    return camera;
+}
+
+static cv::Mat MakeTexture(const cv::Size& size, cv::RNG& rng) {
+    cv::Mat texture(size, CV_8UC3);
+    rng.fill(texture, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(256));
+    cv::GaussianBlur(texture, texture, cv::Size(0, 0), 1.5);
+    cv::normalize(texture, texture, 0, 255, cv::NORM_MINMAX);
+    return texture;
+}
+
+static bool GenerateScene(const SceneConfig& config, const SA_Parameters& params, const fs::path& video_path, Scene& scene, std::string& error) {
+    const float scale = (float)params.scale_factor;
+    const int grid_cols = std::max(1, (int)std::ceil(std::sqrt(config.templates * (double)config.width / config.height)));
+    const int grid_rows = (config.templates + grid_cols - 1) / grid_cols;
+    const float cell_w = (float)config.width / grid_cols;
+    const float cell_h = (float)config.height / grid_rows;
+
+    // Cards must keep the template on themselves at the largest displacement.
+    const float max_shift_full = config.max_shift * scale;
+    const float card_half = 0.5f * std::min(cell_w, cell_h) - max_shift_full - 2.0f;
+    if (card_half < 0.5f * params.template_size * scale + max_shift_full) {
+        error = "Cells are too small for the template size and max shift; lower --templates or --max-shift.";
+        return false;
+    }
+    if (params.search_window_size - params.template_size < 2 * (int)std::ceil(config.max_shift)) {
+        error = "The search window cannot contain the largest shift; lower --max-shift.";
+        return false;
+    }
+
+    std::vector<float> parallax(config.layers);
+    for (int k = 0; k < config.layers; ++k) parallax[k] = (k + 1.0f) / config.layers;
+    std::vector<cv::Point2f> camera = GenerateCameraPath(config);
+
+    cv::RNG rng(config.seed);
+    cv::Size frame_size(config.width, config.height);
+    std::vector<cv::Mat> layer_textures, layer_masks;
+    for (int k = 0; k < config.layers; ++k) {
+        layer_textures.push_back(MakeTexture(frame_size, rng));
+        layer_masks.push_back(cv::Mat(frame_size, CV_32F, cv::Scalar(k == 0 ? 1.0f : 0.0f)));
+    }
+
+    scene.template_points.clear();
+    scene.truth.assign(config.templates, std::vector<cv::Point2f>(config.frames));
+    for (int t = 0; t < config.templates; ++t) {
+        int layer = t % config.layers;
+        cv::Point2f centre((t % grid_cols + 0.5f) * cell_w, (t / grid_cols + 0.5f) * cell_h);
+        if (layer > 0) {
+            cv::Rect card(cvRound(centre.x - card_half), cvRound(centre.y - card_half), cvRound(2 * card_half), cvRound(2 * card_half));
+            layer_masks[layer](card).setTo(1.0f);
+        }
+        int half = params.template_size / 2;
+        scene.template_points.emplace_back(cvRound(centre.x / scale) - half, cvRound(centre.y / scale) - half);
+        for (int i = 0; i < config.frames; ++i) {
+            scene.truth[t][i] = (camera[i] - camera[0]) * (parallax[layer] * config.max_shift);
+        }
+    }
+
+    cv::VideoWriter writer(video_path.string(), cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 30.0, frame_size);
+    if (!writer.isOpened()) {
+        error = "Cannot open a video writer for '" + video_path.string() + "'";
+        return false;
+    }
+    writer.set(cv::VIDEOWRITER_PROP_QUALITY, 100);
+
+    cv::Mat frame_f, layer_f, mask_f, mask_3, inverse_3, frame_8u;
+    for (int i = 0; i < config.frames; ++i) {
+        frame_f = cv::Mat::zeros(frame_size, CV_32FC3);
+        for (int k = 0; k < config.layers; ++k) {
+            cv::Point2f d = (camera[i] - camera[0]) * (parallax[k] * max_shift_full);
+            cv::Mat warp = (cv::Mat_<double>(2, 3) << 1, 0, d.x, 0, 1, d.y);
+            cv::warpAffine(layer_textures[k], layer_f, warp, frame_size, cv::INTER_LINEAR, cv::BORDER_REFLECT);
+            cv::warpAffine(layer_masks[k], mask_f, warp, frame_size, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+            layer_f.convertTo(layer_f, CV_32FC3);
+            cv::merge(std::vector<cv::Mat>(3, mask_f), mask_3);
+            cv::subtract(cv::Scalar::all(1.0), mask_3, inverse_3);
+            frame_f = frame_f.mul(inverse_3) + layer_f.mul(mask_3);
+        }
+        frame_f.convertTo(frame_8u, CV_8UC3);
+        writer.write(frame_8u);
+    }
+    writer.release();
+    scene.video_path = video_path.string();
+    return true;
+}
+
+static double StageMs(const SA_Metrics& metrics, const std::string& name) {
+    double ms = 0.0;
+    for (size_t s = metrics.load_stage_count; s < metrics.stages.size(); ++s) {
+        if (metrics.stages[s].name == name) ms += metrics.stages[s].duration_ms;
+    }
+    return ms;
+}
+
+static bool RunVariant(const Scene& scene, const Variant& variant, int repeat, BenchResult& result, std::string& error) {
+    SA_Parameters params = variant.params;
+    params.template_points = scene.template_points;
+    result = BenchResult();
+    result.name = variant.name;
+
+    // Keep the fastest run per column; accuracy is deterministic across repeats.
+    for (int r = 0; r < std::max(1, repeat); ++r) {
+        SyntheticAperture processor;
+        SA_Clock::time_point start = SA_Clock::now();
+        if (!processor.loadVideo(scene.video_path, params)) {
+            error = processor.getStatusMessage();
+            return false;
+        }
+        double load_ms = elapsedMs(start);
+        if (!processor.process(params)) {
+            error = processor.getStatusMessage();
+            return false;
+        }
+        double total_ms = elapsedMs(start);
+
+        const SA_Metrics& metrics = processor.getMetrics();
+        double tracking_ms = StageMs(metrics, "Tracking");
+        double depth_ms = StageMs(metrics, "Depth map");
+        double synthesis_ms = StageMs(metrics, "Synthesis");
+        if (r == 0) {
+            result.load_ms = load_ms;
+            result.tracking_ms = tracking_ms;
+            result.depth_ms = depth_ms;
+            result.synthesis_ms = synthesis_ms;
+            result.total_ms = total_ms;
+        } else {
+            result.load_ms = std::min(result.load_ms, load_ms);
+            result.tracking_ms = std::min(result.tracking_ms, tracking_ms);
+            result.depth_ms = std::min(result.depth_ms, depth_ms);
+            result.synthesis_ms = std::min(result.synthesis_ms, synthesis_ms);
+            result.total_ms = std::min(result.total_ms, total_ms);
+        }
+
+        if (r > 0) continue;
+        const auto& shifts = processor.getAllShifts();
+        const auto& frames = processor.getSelectedFrames();
+        double sum = 0.0, sum_sq = 0.0;
+        size_t count = 0;
+        for (size_t t = 0; t < shifts.size(); ++t) {
+            for (size_t i = 1; i < shifts[t].size() && i < frames.size(); ++i) {
+                double e = cv::norm(shifts[t][i] - scene.truth[t][frames[i]]);
+                sum += e;
+                sum_sq += e * e;
+                result.max_error = std::max(result.max_error, e);
+                count++;
+            }
+        }
+        if (count > 0) {
+            result.mean_error = sum / count;
+            result.rms_error = std::sqrt(sum_sq / count);
+        }
+    }
+    return true;
+}
+
+static std::vector<Variant> BuildVariants(const SA_Parameters& base, bool sweep) {
+    if (!sweep) return { { "custom", base } };
+
+    std::vector<Variant> variants;
+    SA_Parameters p = base;
+    p.pyramid_levels = 0;
+    p.subpixel_refinement = false;
+    p.correlation_method = SA_CorrelationMethod::Spatial;
+    variants.push_back({ "spatial", p });
+    p.subpixel_refinement = true;
+    variants.push_back({ "spatial+subpixel", p });
+    p.pyramid_levels = 2;
+    variants.push_back({ "pyramid2+subpixel", p });
+    p.pyramid_levels = 0;
+    p.correlation_method = SA_CorrelationMethod::FFT;
+    variants.push_back({ "fft+subpixel", p });
+    p.correlation_method = SA_CorrelationMethod::Spatial;
+    p.predictive_search = true;
+    variants.push_back({ "predictive+subpixel", p });
+    p.predictive_search = false;
+    p.tracker = SA_TrackerType::InverseCompositional;
+    variants.push_back({ "inverse-compositional", p });
+    p.tracker = SA_TrackerType::SparseMotion;
+    variants.push_back({ "sparse-motion", p });
+    p.tracker = SA_TrackerType::NCC;
+    p.selected_frames = std::max(2, base.max_frames / 4);
+    variants.push_back({ "selected+subpixel", p });
+    p.selected_frames = 0;
+    p.streaming = true;
+    variants.push_back({ "streaming+subpixel", p });
+    return variants;
+}
+
+static void PrintResults(const SceneConfig& config, const std::vector<BenchResult>& results) {
+    std::cout << "\n" << config.width << "x" << config.height << ", " << config.frames << " frames, "
+              << config.templates << " templates, " << config.layers << " layers, " << config.path << " path\n";
+    std::cout << std::left << std::setw(22) << "variant" << std::right
+              << std::setw(10) << "load ms" << std::setw(10) << "track ms" << std::setw(10) << "depth ms"
+              << std::setw(10) << "synth ms" << std::setw(10) << "total ms" << std::setw(10) << "fps"
+              << std::setw(10) << "err mean" << std::setw(10) << "err rms" << std::setw(10) << "err max" << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& r : results) {
+        double fps = r.total_ms > 0.0 ? config.frames * 1000.0 / r.total_ms : 0.0;
+        std::cout << std::left << std::setw(22) << r.name << std::right
+                  << std::setw(10) << r.load_ms << std::setw(10) << r.tracking_ms << std::setw(10) << r.depth_ms
+                  << std::setw(10) << r.synthesis_ms << std::setw(10) << r.total_ms << std::setw(10) << fps
+                  << std::setw(10) << r.mean_error << std::setw(10) << r.rms_error << std::setw(10) << r.max_error << "\n";
+    }
+}
+
+static bool WriteCsv(const std::string& path, const SceneConfig& config, const std::vector<BenchResult>& results) {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "variant,width,height,frames,templates,layers,load_ms,tracking_ms,depth_ms,synthesis_ms,total_ms,error_mean,error_rms,error_max\n";
+    for (const auto& r : results) {
+        out << r.name << "," << config.width << "," << config.height << "," << config.frames << "," << config.templates << ","
+            << config.layers << "," << r.load_ms << "," << r.tracking_ms << "," << r.depth_ms << "," << r.synthesis_ms << ","
+            << r.total_ms << "," << r.mean_error << "," << r.rms_error << "," << r.max_error << "\n";
+    }
+    return (bool)out;
+}
+
+// The size-specialized NCC kernels against cv::matchTemplate, on a blurred noise window so
+// the template is well textured. max diff is the largest difference between the two maps.
+static void BenchmarkNCCKernels(int window_size, int repeat) {
+    cv::RNG rng(1);
+    cv::Mat window(window_size, window_size, CV_8U);
+    rng.fill(window, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(256));
+    cv::GaussianBlur(window, window, cv::Size(3, 3), 0);
+    const int iterations = 100 * std::max(1, repeat);
+
+    std::cout << "\nNCC kernels, " << window_size << "x" << window_size << " window, " << iterations << " iterations\n";
+    std::cout << std::left << std::setw(10) << "template" << std::right << std::setw(14) << "generic us" << std::setw(14) << "kernel us"
+              << std::setw(10) << "speedup" << std::setw(12) << "max diff" << "\n";
+    for (int size : { 16, 24, 32, 48, 64 }) {
+        if (size > window_size) continue;
+        cv::Mat templ = window(cv::Rect((window_size - size) / 2, (window_size - size) / 2, size, size)).clone();
+        NCCTemplate prepared(templ);
+        cv::Mat generic, specialized;
+
+        SA_Clock::time_point start = SA_Clock::now();
+        for (int i = 0; i < iterations; ++i) cv::matchTemplate(window, templ, generic, cv::TM_CCOEFF_NORMED);
+        double generic_us = elapsedMs(start) * 1000.0 / iterations;
+        start = SA_Clock::now();
+        for (int i = 0; i < iterations; ++i) prepared.match(window, specialized);
+        double kernel_us = elapsedMs(start) * 1000.0 / iterations;
+
+        std::cout << std::left << std::setw(10) << size << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(14) << generic_us << std::setw(14) << kernel_us << std::setw(9) << generic_us / kernel_us << "x"
+                  << std::setprecision(5) << std::setw(12) << cv::norm(generic, specialized, cv::NORM_INF) << "\n";
+    }
+}
+
+static void PrintUsage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [options]\n"
+              << "  scene:   --width W --height H --frames N --templates T --layers L --max-shift PX\n"
+              << "           --path circle|walk --seed S --keep-video FILE.avi\n"
+              << "  params:  --scale S --render-scale S --template-size N --search-window N --pyramid N --subpixel --fft\n"
+              << "           --predictive --ic --sparse --streaming --fixed-point --depth-planes N --select N\n"
+              << "  run:     --sweep (compare tracking variants) --kernels (time NCC kernels only) --repeat N --csv FILE" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    SceneConfig config;
+    SA_Parameters params;
+    bool sweep = false;
+    bool kernels = false;
+    int repeat = 1;
+    std::string csv_path, keep_video;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--width" && has_value) config.width = std::atoi(argv[++i]);
+        else if (arg == "--height" && has_value) config.height = std::atoi(argv[++i]);
+        else if (arg == "--frames" && has_value) config.frames = std::atoi(argv[++i]);
+        else if (arg == "--templates" && has_value) config.templates = std::atoi(argv[++i]);
+        else if (arg == "--layers" && has_value) config.layers = std::atoi(argv[++i]);
+        else if (arg == "--max-shift" && has_value) config.max_shift = (float)std::atof(argv[++i]);
+        else if (arg == "--path" && has_value) config.path = argv[++i];
+        else if (arg == "--seed" && has_value) config.seed = std::atoi(argv[++i]);
+        else if (arg == "--keep-video" && has_value) keep_video = argv[++i];
+        else if (arg == "--scale" && has_value) params.scale_factor = std::atoi(argv[++i]);
+        else if (arg == "--render-scale" && has_value) params.render_scale_factor = std::atoi(argv[++i]);
+        else if (arg == "--template-size" && has_value) params.template_size = std::atoi(argv[++i]);
+        else if (arg == "--search-window" && has_value) params.search_window_size = std::atoi(argv[++i]);
+        else if (arg == "--pyramid" && has_value) params.pyramid_levels = std::atoi(argv[++i]);
+        else if (arg == "--depth-planes" && has_value) params.depth_planes = std::atoi(argv[++i]);
+        else if (arg == "--select" && has_value) params.selected_frames = std::atoi(argv[++i]);
+        else if (arg == "--subpixel") params.subpixel_refinement = true;
+        else if (arg == "--fft") params.correlation_method = SA_CorrelationMethod::FFT;
+        else if (arg == "--predictive") params.predictive_search = true;
+        else if (arg == "--ic") params.tracker = SA_TrackerType::InverseCompositional;
+        else if (arg == "--sparse") params.tracker = SA_TrackerType::SparseMotion;
+        else if (arg == "--streaming") params.streaming = true;
+        else if (arg == "--fixed-point") params.fixed_point_accumulation = true;
+        else if (arg == "--sweep") sweep = true;
+        else if (arg == "--kernels") kernels = true;
+        else if (arg == "--repeat" && has_value) repeat = std::atoi(argv[++i]);
+        else if (arg == "--csv" && has_value) csv_path = argv[++i];
+        else {
+            PrintUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (config.width <= 0 || config.height <= 0 || config.frames < 2 || config.templates < 1 || config.layers < 1 || params.scale_factor < 1) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+    params.max_frames = config.frames;
+    if (kernels) {
+        BenchmarkNCCKernels(params.search_window_size, repeat);
+        return 0;
+    }
+
+    fs::path video_path = keep_video.empty() ? fs::temp_directory_path() / "sa_benchmark_scene.avi" : fs::path(keep_video);
+    std::cout << "--- Generating Scene: " << video_path.string() << " ---" << std::endl;
+    Scene scene;
+    std::string error;
+    if (!GenerateScene(config, params, video_path, scene, error)) {
+        std::cerr << "FATAL ERROR: " << error << std::endl;
+        return 1;
+    }
+
+    // The pipeline logs every step; only the table is of interest here.
+    std::streambuf* cout_buffer = std::cout.rdbuf();
+    std::ostringstream pipeline_log;
+    std::vector<BenchResult> results;
+    int status = 0;
+    for (const auto& variant : BuildVariants(params, sweep)) {
+        BenchResult result;
+        std::cout.rdbuf(pipeline_log.rdbuf());
+        bool ok = RunVariant(scene, variant, repeat, result, error);
+        std::cout.rdbuf(cout_buffer);
+        pipeline_log.str("");
+        if (!ok) {
+            std::cerr << "Variant '" << variant.name << "' failed: " << error << std::endl;
+            status = 1;
+            continue;
+        }
+        results.push_back(result);
+    }
+
+    PrintResults(config, results);
+    if (!csv_path.empty() && !WriteCsv(csv_path, config, results)) {
+        std::cerr << "Error: Cannot write '" << csv_path << "'" << std::endl;
+        status = 1;
+    }
+    if (keep_video.empty()) {
+        std::error_code ec;
+        fs::remove(video_path, ec);
+    }
+    return status;
+}
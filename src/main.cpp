@@ -8,6 +8,11 @@
 #include <chrono>
 #include <iomanip>
 #include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
 
 #include "SyntheticAperture.h"
 
@@ -19,12 +24,19 @@ std::string GenerateTimestampedFilename(const std::string& base_name, const std:
     return ss.str();
 }
 
+std::string DefaultFrameCacheDir() {
+    std::error_code ec;
+    std::filesystem::path temp = std::filesystem::temp_directory_path(ec);
+    return ((ec ? std::filesystem::path(".") : temp) / "synthetic_aperture_cache").string();
+}
+
 struct UIState {
     bool show_config_window = true;
     bool show_input_window = true;
     bool show_output_window = true;
     bool show_plot_window = true;
     bool show_properties_window = true;
+    bool show_timeline_window = true;
     bool adding_template_mode = false;
     float zoom_input = 1.0f;
     float zoom_output = 1.0f;
@@ -32,6 +44,9 @@ struct UIState {
     bool auto_fit_output = true;
 
     bool processing_in_progress = false;
+    // Focus chosen on the slider while a refocus was still rendering; started when it finishes.
+    bool focus_pending = false;
+    float pending_focus = 0.0f;
     std::string last_process_message;
 };
 
@@ -54,6 +69,41 @@ struct TextureManager {
     }
 };
 
+// Runs loadVideo()/process()/refocus() off the render thread. The UI reads results only through
+// SyntheticAperture::getSnapshot(), which the worker publishes when it finishes.
+struct BackgroundTask {
+    enum class Kind { None, LoadVideo, Process, Refocus };
+
+    Kind kind = Kind::None;
+    bool success = false;
+    std::atomic<bool> finished{false};
+    std::thread thread;
+
+    ~BackgroundTask() {
+        if (thread.joinable()) thread.join();
+    }
+
+    bool isRunning() const { return kind != Kind::None; }
+
+    void start(Kind task_kind, std::function<bool()> fn) {
+        kind = task_kind;
+        finished = false;
+        thread = std::thread([this, fn]() {
+            success = fn();
+            finished = true;
+        });
+    }
+
+    // Returns the kind of the task that just completed (once), Kind::None otherwise.
+    Kind poll() {
+        if (kind == Kind::None || !finished) return Kind::None;
+        thread.join();
+        Kind done = kind;
+        kind = Kind::None;
+        return done;
+    }
+};
+
 void MatToTexture(const cv::Mat& mat, GLuint& texture) {
     if (mat.empty()) return;
     if (texture == 0) glGenTextures(1, &texture);
@@ -85,7 +135,7 @@ bool IsMousePosValid(const cv::Point2i& pos, const cv::Mat& frame, int template_
 }
 
 
-void RenderConfigWindow(SyntheticAperture& processor, SA_Parameters& params, UIState& ui_state, TextureManager& textures) {
+void RenderConfigWindow(SyntheticAperture& processor, const SA_Snapshot& snapshot, SA_Parameters& params, UIState& ui_state, BackgroundTask& task) {
     if (!ui_state.show_config_window) return;
 
     static bool first_show = true;
@@ -101,23 +151,65 @@ void RenderConfigWindow(SyntheticAperture& processor, SA_Parameters& params, UIS
     static char videoPathBuf[1024] = "/Users/user/Downloads/IMG_2116.MOV";
     ImGui::InputText("##VideoPath", videoPathBuf, sizeof(videoPathBuf));
 
+    if (task.isRunning()) ImGui::BeginDisabled();
     if (ImGui::Button("Load Video", ImVec2(-1, 0))) {
-        if (processor.loadVideo(videoPathBuf, params)) {
-            MatToTexture(processor.getFirstColorFrame(), textures.firstFrameTexture);
-            params.template_points.clear();
-            ui_state.last_process_message = "Video loaded. Add templates to begin.";
-        }
+        std::string path = videoPathBuf;
+        SA_Parameters load_params = params;
+        ui_state.adding_template_mode = false;
+        ui_state.last_process_message = "Loading video...";
+        task.start(BackgroundTask::Kind::LoadVideo, [&processor, path, load_params]() { return processor.loadVideo(path, load_params); });
     }
+    if (task.isRunning()) ImGui::EndDisabled();
 
     ImGui::SeparatorText("Processing Parameters");
     ImGui::InputInt("Max Frames", &params.max_frames, 1, 10);
     params.max_frames = std::max(1, params.max_frames);
+    ImGui::InputInt("Start Frame", &params.start_frame, 1, 30);
+    params.start_frame = std::max(0, params.start_frame);
+    ImGui::InputInt("End Frame", &params.end_frame, 1, 30);
+    params.end_frame = std::max(0, params.end_frame);
+    if (ImGui::IsItemHovered()) ImGui::SetTooltip("0 reads to the end of the video.");
+    ImGui::InputInt("Frame Stride", &params.frame_stride, 1, 2);
+    params.frame_stride = std::max(1, params.frame_stride);
+    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Keep every n-th frame for a wider baseline.\nSkipped frames are not decoded to color.");
     ImGui::InputInt("Scale Factor", &params.scale_factor, 1, 2);
     params.scale_factor = std::max(1, params.scale_factor);
+    ImGui::InputInt("Render Scale", &params.render_scale_factor, 1, 2);
+    params.render_scale_factor = std::max(0, params.render_scale_factor);
+    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Downscale of the synthetic image, 0 = Scale Factor. A smaller value\nrenders more detail from tracks measured on the smaller frames,\ndecoding the video again for each render.");
     ImGui::InputInt("Template Size", &params.template_size, 1, 5);
     params.template_size = std::max(10, params.template_size);
     ImGui::InputInt("Search Window", &params.search_window_size, 1, 5);
     params.search_window_size = std::max(params.template_size + 10, params.search_window_size);
+    ImGui::Checkbox("Predictive Search", &params.predictive_search);
+    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Center each frame's search on the motion predicted from the previous\nframes and shrink it to the prediction error. NCC tracker only.");
+    ImGui::SliderInt("Pyramid Levels", &params.pyramid_levels, 0, 4);
+    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Coarse-to-fine search. 0 searches the whole window at full resolution.");
+    static const char* correlation_methods[] = { "Spatial (matchTemplate)", "FFT (cached spectra)" };
+    int correlation_method = (int)params.correlation_method;
+    if (ImGui::Combo("Correlation", &correlation_method, correlation_methods, IM_ARRAYSIZE(correlation_methods))) {
+        params.correlation_method = (SA_CorrelationMethod)correlation_method;
+    }
+    static const char* trackers[] = { "NCC search", "Inverse compositional", "Sparse motion field" };
+    int tracker = (int)params.tracker;
+    if (ImGui::Combo("Tracker", &tracker, trackers, IM_ARRAYSIZE(trackers))) {
+        params.tracker = (SA_TrackerType)tracker;
+    }
+    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Inverse compositional follows each template from the previous frame\nin a few sub-pixel iterations, falling back to NCC search where it fails.\nSparse motion field tracks corners once and only searches each\ntemplate's parallax, so extra templates are nearly free.");
+    ImGui::Checkbox("Sub-pixel Shifts", &params.subpixel_refinement);
+    ImGui::SliderInt("Depth Planes", &params.depth_planes, 0, 64);
+    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Dense plane-sweep depth map. 0 draws one marker per template.");
+    ImGui::Checkbox("Fixed-point Accumulation", &params.fixed_point_accumulation);
+    ImGui::InputInt("Selected Frames", &params.selected_frames, 1, 10);
+    params.selected_frames = std::max(0, params.selected_frames);
+    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Keep this many frames spread evenly over the aperture, chosen\nfrom template 1's track. 0 uses every loaded frame.");
+    ImGui::Checkbox("Streaming (low memory)", &params.streaming);
+    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Decode frames while processing instead of keeping them all in memory.\nTakes effect on the next 'Load Video'.");
+    bool frame_cache = !params.frame_cache_dir.empty();
+    if (ImGui::Checkbox("Cache Decoded Frames", &frame_cache)) {
+        params.frame_cache_dir = frame_cache ? DefaultFrameCacheDir() : std::string();
+    }
+    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Keep preprocessed frames on disk and map them on reload\ninstead of decoding again. Ignored in streaming mode.");
 
     ImGui::SeparatorText("Depth Map Templates");
     ImVec4 button_color = ui_state.adding_template_mode ? ImVec4(0.8f, 0.3f, 0.3f, 1.0f) : ImVec4(0.26f, 0.59f, 0.98f, 1.0f);
@@ -128,7 +220,7 @@ void RenderConfigWindow(SyntheticAperture& processor, SA_Parameters& params, UIS
     }
 
     if (ImGui::Button(was_adding_mode ? "Cancel Adding" : "Add Templates...", ImVec2(-1, 0))) {
-        if (processor.isVideoLoaded()) {
+        if (snapshot.video_loaded) {
             ui_state.adding_template_mode = !ui_state.adding_template_mode;
         }
     }
@@ -151,24 +243,36 @@ void RenderConfigWindow(SyntheticAperture& processor, SA_Parameters& params, UIS
     ImGui::EndChild();
 
     ImGui::SeparatorText("Processing & Output");
-    bool can_process = processor.isVideoLoaded() && params.template_points.size() >= 2;
-    if (!can_process || ui_state.processing_in_progress) ImGui::BeginDisabled();
+    bool can_process = snapshot.video_loaded && params.template_points.size() >= 2;
+    if (!can_process || task.isRunning()) ImGui::BeginDisabled();
 
     if (ImGui::Button(ui_state.processing_in_progress ? "PROCESSING..." : "PROCESS", ImVec2(-1, 40))) {
+        SA_Parameters process_params = params;
         ui_state.processing_in_progress = true;
         ui_state.last_process_message = "Processing...";
-        if (processor.process(params)) {
-            textures.needs_update = true;
-            ui_state.last_process_message = "✓ Processing completed successfully!";
-        } else {
-            ui_state.last_process_message = "⚠ Processing failed: " + processor.getStatusMessage();
-        }
-        ui_state.processing_in_progress = false;
+        task.start(BackgroundTask::Kind::Process, [&processor, process_params]() { return processor.process(process_params); });
     }
-    if (!can_process || ui_state.processing_in_progress) {
+    if (!can_process || task.isRunning()) {
         ImGui::EndDisabled();
-        if (!processor.isVideoLoaded()) ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Load video first");
-        else if (params.template_points.size() < 2) ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Add at least 2 templates");
+        if (!task.isRunning()) {
+            if (!snapshot.video_loaded) ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Load video first");
+            else if (params.template_points.size() < 2) ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Add at least 2 templates");
+        }
+    }
+
+    if (task.isRunning()) {
+        SA_Progress progress = processor.getProgress();
+        char overlay[128];
+        float fraction;
+        if (progress.total > 0) {
+            fraction = std::min(1.0f, (float)progress.done / progress.total);
+            snprintf(overlay, sizeof(overlay), "%s %d/%d", progress.stage.c_str(), progress.done, progress.total);
+        } else {
+            fraction = -1.0f * (float)ImGui::GetTime();
+            snprintf(overlay, sizeof(overlay), "%s", progress.stage.c_str());
+        }
+        ImGui::ProgressBar(fraction, ImVec2(-1, 0), overlay);
+        if (ImGui::Button("Cancel", ImVec2(-1, 0))) processor.requestCancel();
     }
 
     if (!ui_state.last_process_message.empty()) {
@@ -185,7 +289,7 @@ void RenderConfigWindow(SyntheticAperture& processor, SA_Parameters& params, UIS
     ImGui::End();
 }
 
-void RenderPropertiesWindow(SyntheticAperture& processor, SA_Parameters& params, UIState& ui_state) {
+void RenderPropertiesWindow(SyntheticAperture& processor, const SA_Snapshot& snapshot, SA_Parameters& params, UIState& ui_state) {
     if (!ui_state.show_properties_window) return;
 
     static bool first_show = true;
@@ -218,14 +322,14 @@ void RenderPropertiesWindow(SyntheticAperture& processor, SA_Parameters& params,
     ImGui::InputInt("Height", &params.override_height);
     ImGui::SliderInt("Rotation", &params.rotation, 0, 360);
 
-    if (processor.isProcessed()) {
+    if (snapshot.processed) {
         ImGui::SeparatorText("Processing Results");
         ImGui::Text("Templates processed: %zu", params.template_points.size());
     }
     ImGui::End();
 }
 
-void RenderInputWindow(SyntheticAperture& processor, SA_Parameters& params, UIState& ui_state, TextureManager& textures) {
+void RenderInputWindow(const SA_Snapshot& snapshot, SA_Parameters& params, UIState& ui_state, TextureManager& textures) {
     if (!ui_state.show_input_window) return;
 
     static bool first_show = true;
@@ -233,9 +337,9 @@ void RenderInputWindow(SyntheticAperture& processor, SA_Parameters& params, UISt
 
     ImGui::Begin("Input Frame", &ui_state.show_input_window);
 
-    if (!processor.isVideoLoaded()) { ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "No video loaded"); ImGui::End(); return; }
+    if (!snapshot.video_loaded) { ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "No video loaded"); ImGui::End(); return; }
 
-    cv::Mat frame = processor.getFirstColorFrame();
+    const cv::Mat& frame = snapshot.first_color_frame;
     ImVec2 available_size = ImGui::GetContentRegionAvail();
     float zoom = ui_state.auto_fit_input ? CalculateFitZoom(frame, available_size) : ui_state.zoom_input;
     if (ui_state.auto_fit_input) ui_state.zoom_input = zoom;
@@ -287,7 +391,11 @@ void RenderInputWindow(SyntheticAperture& processor, SA_Parameters& params, UISt
     ImGui::End();
 }
 
-void RenderOutputWindow(SyntheticAperture& processor, UIState& ui_state, TextureManager& textures) {
+void StartRefocus(SyntheticAperture& processor, BackgroundTask& task, float focus) {
+    task.start(BackgroundTask::Kind::Refocus, [&processor, focus]() { return processor.refocus(focus); });
+}
+
+void RenderOutputWindow(SyntheticAperture& processor, const SA_Snapshot& snapshot, UIState& ui_state, TextureManager& textures, BackgroundTask& task) {
     if (!ui_state.show_output_window) return;
 
     static bool first_show = true;
@@ -295,7 +403,7 @@ void RenderOutputWindow(SyntheticAperture& processor, UIState& ui_state, Texture
 
     ImGui::Begin("Output Results", &ui_state.show_output_window);
 
-    if (!processor.isProcessed()) {
+    if (!snapshot.processed) {
         ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "No processing results");
         if (ui_state.processing_in_progress) {
             ImGui::TextColored(ImVec4(0.0f, 1.0f, 1.0f, 1.0f), "⏳ Processing in progress...");
@@ -307,7 +415,7 @@ void RenderOutputWindow(SyntheticAperture& processor, UIState& ui_state, Texture
     ImGui::BeginTabBar("OutputTabs");
 
     if (ImGui::BeginTabItem("Depth Map")) {
-        cv::Mat depth_map = processor.getDepthMap();
+        const cv::Mat& depth_map = snapshot.depth_map;
         if (!depth_map.empty()) {
             if (ImGui::Button("Save Depth Map")) {
                 std::string filename = GenerateTimestampedFilename("depth_map", "png");
@@ -344,7 +452,7 @@ void RenderOutputWindow(SyntheticAperture& processor, UIState& ui_state, Texture
     }
 
     if (ImGui::BeginTabItem("Synthetic Aperture")) {
-        cv::Mat synthetic_img = processor.getSyntheticImage();
+        const cv::Mat& synthetic_img = snapshot.synthetic_image;
         if (!synthetic_img.empty()) {
             if (ImGui::Button("Save Synthetic Image")) {
                 std::string filename = GenerateTimestampedFilename("synthetic_aperture", "png");
@@ -356,6 +464,41 @@ void RenderOutputWindow(SyntheticAperture& processor, UIState& ui_state, Texture
             }
             ImGui::SameLine();
 
+            // Refocusing may decode the whole clip again, so it renders on the worker. Slider moves
+            // made while a render is running collapse into one pending focus.
+            const bool refocusing = task.kind == BackgroundTask::Kind::Refocus;
+            if (snapshot.can_refocus && (!task.isRunning() || refocusing)) {
+                // Let the slider reach a little past the nearest and farthest template.
+                float lo = snapshot.min_parallax;
+                float hi = snapshot.max_parallax;
+                float margin = std::max(0.25f * (hi - lo), 0.1f);
+                float focus = ui_state.focus_pending ? ui_state.pending_focus : snapshot.focal_parallax;
+                ImGui::SetNextItemWidth(200);
+                if (ImGui::SliderFloat("Focus", &focus, lo - margin, hi + margin, "%.2f")) {
+                    if (refocusing) {
+                        ui_state.focus_pending = true;
+                        ui_state.pending_focus = focus;
+                    } else {
+                        StartRefocus(processor, task, focus);
+                    }
+                }
+                if (refocusing) ImGui::BeginDisabled();
+                // One button per template; the one the image is focused on is highlighted.
+                for (size_t i = 0; i < snapshot.template_parallaxes.size(); ++i) {
+                    ImGui::SameLine();
+                    std::string label = "T" + std::to_string(i + 1);
+                    const float parallax = snapshot.template_parallaxes[i];
+                    const bool in_focus = std::fabs(parallax - snapshot.focal_parallax) < 1e-4f;
+                    if (in_focus) ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.8f, 0.5f, 0.2f, 1.0f));
+                    if (ImGui::SmallButton(label.c_str()) && !task.isRunning()) {
+                        task.start(BackgroundTask::Kind::Refocus, [&processor, i]() { return processor.refocusOnTemplate(i); });
+                    }
+                    if (in_focus) ImGui::PopStyleColor();
+                    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Focus on template %zu (parallax %.2f)", i + 1, parallax);
+                }
+                if (refocusing) ImGui::EndDisabled();
+            }
+
             ImVec2 available_size = ImGui::GetContentRegionAvail();
             float zoom = ui_state.auto_fit_output ? CalculateFitZoom(synthetic_img, available_size) : ui_state.zoom_output;
             if (ui_state.auto_fit_output) ui_state.zoom_output = zoom;
@@ -369,7 +512,7 @@ void RenderOutputWindow(SyntheticAperture& processor, UIState& ui_state, Texture
     }
 
     if (ImGui::BeginTabItem("Focal Template")) {
-        cv::Mat template_img = processor.getTemplateImage();
+        const cv::Mat& template_img = snapshot.template_image;
         if (!template_img.empty()) {
             if (ImGui::Button("Save Template Image")) {
                 std::string filename = GenerateTimestampedFilename("focal_template", "png");
@@ -397,7 +540,7 @@ void RenderOutputWindow(SyntheticAperture& processor, UIState& ui_state, Texture
     ImGui::End();
 }
 
-void RenderPlotWindow(SyntheticAperture& processor, UIState& ui_state, std::vector<float>& shiftX, std::vector<float>& shiftY) {
+void RenderPlotWindow(const SA_Snapshot& snapshot, UIState& ui_state, std::vector<float>& shiftX, std::vector<float>& shiftY) {
     if (!ui_state.show_plot_window) return;
 
     static bool first_show = true;
@@ -409,7 +552,7 @@ void RenderPlotWindow(SyntheticAperture& processor, UIState& ui_state, std::vect
 
     ImGui::Begin("Motion Analysis (Template 1)", &ui_state.show_plot_window);
 
-    if (!processor.isProcessed() || shiftX.empty()) {
+    if (!snapshot.processed || shiftX.empty()) {
         ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "No motion data available");
         ImGui::End();
         return;
@@ -435,6 +578,92 @@ void RenderPlotWindow(SyntheticAperture& processor, UIState& ui_state, std::vect
     ImGui::End();
 }
 
+void RenderTimelineWindow(const SA_Snapshot& snapshot, UIState& ui_state) {
+    if (!ui_state.show_timeline_window) return;
+
+    static bool first_show = true;
+    if (first_show) {
+        ImGui::SetNextWindowPos(ImVec2(700, 860));
+        ImGui::SetNextWindowSize(ImVec2(700, 320));
+        first_show = false;
+    }
+
+    ImGui::Begin("Timeline", &ui_state.show_timeline_window);
+
+    const SA_Metrics& metrics = snapshot.metrics;
+    if (metrics.stages.empty()) {
+        ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "No timing data available");
+        ImGui::End();
+        return;
+    }
+
+    if (ImGui::Button("Export JSON")) {
+        std::string filename = GenerateTimestampedFilename("metrics", "json");
+        std::ofstream out(filename);
+        out << metrics.toJson();
+        if (out) {
+            ui_state.last_process_message = "✓ Saved " + filename;
+        } else {
+            ui_state.last_process_message = "⚠ Failed to save " + filename;
+        }
+    }
+    ImGui::SameLine();
+    ImGui::Text("Frames: %d  |  Resident frames: %.1f MB", metrics.frames_processed,
+                metrics.resident_frame_bytes / (1024.0 * 1024.0));
+
+    // One row per stage, drawn as bars on a shared millisecond axis.
+    const int num_stages = (int)metrics.stages.size();
+    std::vector<const char*> labels;
+    std::vector<double> rows;
+    double end_ms = 0.0;
+    for (int s = 0; s < num_stages; ++s) {
+        labels.push_back(metrics.stages[s].name.c_str());
+        rows.push_back(s);
+        end_ms = std::max(end_ms, metrics.stages[s].start_ms + metrics.stages[s].duration_ms);
+    }
+
+    if (ImPlot::BeginPlot("Stages", ImVec2(-1, 40.0f + 24.0f * num_stages))) {
+        ImPlot::SetupAxes("ms", nullptr, 0, ImPlotAxisFlags_Invert);
+        ImPlot::SetupAxisLimits(ImAxis_X1, 0.0, std::max(end_ms, 1.0), ImPlotCond_Always);
+        ImPlot::SetupAxisLimits(ImAxis_Y1, -0.5, num_stages - 0.5, ImPlotCond_Always);
+        ImPlot::SetupAxisTicks(ImAxis_Y1, rows.data(), num_stages, labels.data());
+
+        ImDrawList* draw_list = ImPlot::GetPlotDrawList();
+        ImPlot::PushPlotClipRect();
+        for (int s = 0; s < num_stages; ++s) {
+            const SA_StageTiming& stage = metrics.stages[s];
+            ImVec2 p0 = ImPlot::PlotToPixels(stage.start_ms, s - 0.35);
+            ImVec2 p1 = ImPlot::PlotToPixels(stage.start_ms + stage.duration_ms, s + 0.35);
+            ImU32 color = ImGui::GetColorU32(ImPlot::GetColormapColor(s));
+            draw_list->AddRectFilled(ImVec2(p0.x, std::min(p0.y, p1.y)), ImVec2(std::max(p1.x, p0.x + 1.0f), std::max(p0.y, p1.y)), color);
+        }
+        ImPlot::PopPlotClipRect();
+
+        if (ImPlot::IsPlotHovered()) {
+            ImPlotPoint mouse = ImPlot::GetPlotMousePos();
+            int s = (int)std::lround(mouse.y);
+            if (s >= 0 && s < num_stages) {
+                ImGui::SetTooltip("%s: %.1f ms", labels[s], metrics.stages[s].duration_ms);
+            }
+        }
+        ImPlot::EndPlot();
+    }
+
+    if (!metrics.match_latency_ms.empty() && ImPlot::BeginPlot("Match Latency", ImVec2(-1, 150))) {
+        ImPlot::SetupAxes("Frame", "ms", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit);
+        ImPlot::PlotLine("Mean per template", metrics.match_latency_ms.data(), (int)metrics.match_latency_ms.size());
+        ImPlot::EndPlot();
+    }
+
+    if (!metrics.template_tracking_ms.empty() && ImGui::CollapsingHeader("Tracking Time per Template")) {
+        for (size_t t = 0; t < metrics.template_tracking_ms.size(); ++t) {
+            ImGui::Text("T%d: %.1f ms", (int)t + 1, metrics.template_tracking_ms[t]);
+        }
+    }
+
+    ImGui::End();
+}
+
 void SetupMainMenuBar(UIState& ui_state) {
     if (ImGui::BeginMainMenuBar()) {
         if (ImGui::BeginMenu("View")) {
@@ -443,6 +672,7 @@ void SetupMainMenuBar(UIState& ui_state) {
             ImGui::MenuItem("Input Frame", nullptr, &ui_state.show_input_window);
             ImGui::MenuItem("Output Results", nullptr, &ui_state.show_output_window);
             ImGui::MenuItem("Motion Analysis", nullptr, &ui_state.show_plot_window);
+            ImGui::MenuItem("Timeline", nullptr, &ui_state.show_timeline_window);
             ImGui::EndMenu();
         }
         ImGui::EndMainMenuBar();
@@ -483,30 +713,63 @@ int main(int, char**) {
     SA_Parameters params;
     UIState ui_state;
     TextureManager textures;
+    BackgroundTask task;
     std::vector<float> shiftX, shiftY;
 
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
         ImGui_ImplOpenGL3_NewFrame(); ImGui_ImplGlfw_NewFrame(); ImGui::NewFrame();
 
-        SetupMainMenuBar(ui_state);
-        RenderConfigWindow(processor, params, ui_state, textures);
-        RenderPropertiesWindow(processor, params, ui_state);
-        RenderInputWindow(processor, params, ui_state, textures);
-        RenderOutputWindow(processor, ui_state, textures);
-        RenderPlotWindow(processor, ui_state, shiftX, shiftY);
+        // Textures are GL objects, so the worker's results are uploaded here on the render thread.
+        BackgroundTask::Kind completed = task.poll();
+        std::shared_ptr<const SA_Snapshot> snapshot = processor.getSnapshot();
+        if (completed == BackgroundTask::Kind::LoadVideo) {
+            if (task.success) {
+                MatToTexture(snapshot->first_color_frame, textures.firstFrameTexture);
+                params.template_points.clear();
+                ui_state.last_process_message = "Video loaded. Add templates to begin.";
+            } else {
+                ui_state.last_process_message = "⚠ Loading failed: " + processor.getStatusMessage();
+            }
+        } else if (completed == BackgroundTask::Kind::Process) {
+            ui_state.processing_in_progress = false;
+            if (task.success) {
+                textures.needs_update = true;
+                ui_state.last_process_message = "✓ Processing completed successfully!";
+            } else {
+                ui_state.last_process_message = "⚠ Processing failed: " + processor.getStatusMessage();
+            }
+        } else if (completed == BackgroundTask::Kind::Refocus) {
+            if (task.success) {
+                MatToTexture(snapshot->synthetic_image, textures.syntheticTexture);
+            } else {
+                ui_state.last_process_message = "⚠ Refocusing failed: " + processor.getStatusMessage();
+            }
+            // A cancelled or failed render drops the pending focus too.
+            if (ui_state.focus_pending && task.success) StartRefocus(processor, task, ui_state.pending_focus);
+            ui_state.focus_pending = false;
+        }
 
-        if (textures.needs_update && processor.isProcessed()) {
-            MatToTexture(processor.getTemplateImage(), textures.templateTexture);
-            MatToTexture(processor.getSyntheticImage(), textures.syntheticTexture);
-            MatToTexture(processor.getDepthMap(), textures.depthMapTexture);
+        SetupMainMenuBar(ui_state);
+        RenderConfigWindow(processor, *snapshot, params, ui_state, task);
+        RenderPropertiesWindow(processor, *snapshot, params, ui_state);
+        RenderInputWindow(*snapshot, params, ui_state, textures);
+        RenderOutputWindow(processor, *snapshot, ui_state, textures, task);
+        RenderPlotWindow(*snapshot, ui_state, shiftX, shiftY);
+        RenderTimelineWindow(*snapshot, ui_state);
+
+        if (textures.needs_update && snapshot->processed) {
+            MatToTexture(snapshot->template_image, textures.templateTexture);
+            MatToTexture(snapshot->synthetic_image, textures.syntheticTexture);
+            MatToTexture(snapshot->depth_map, textures.depthMapTexture);
 
             shiftX.clear();
             shiftY.clear();
-            const auto& shifts_for_plot = processor.getShifts();
-            for (const auto& shift : shifts_for_plot) {
-                shiftX.push_back(shift.x);
-                shiftY.push_back(shift.y);
+            if (!snapshot->shifts.empty()) {
+                for (const auto& shift : snapshot->shifts[0]) {
+                    shiftX.push_back(shift.x);
+                    shiftY.push_back(shift.y);
+                }
             }
             textures.needs_update = false;
         }
@@ -522,6 +785,11 @@ int main(int, char**) {
         glfwSwapBuffers(window);
     }
 
+    if (task.isRunning()) {
+        processor.requestCancel();
+        task.thread.join();
+    }
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImPlot::DestroyContext();